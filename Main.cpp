@@ -2,15 +2,27 @@
 #include "crow.h"
 #include "Graph.h"
 #include "Algo.h"
+#include "CH.h"
 #include "kdtree.h"  
+#include "GraphLoader.h"
+#include "EdgeIndex.h"
+#include "Parallel.h"
+#include "Metrics.h"
+#include "Log.h"
+#include "RouteCache.h"
+#include "Tour.h"
 #include <fstream>
 #include <sstream>
+#include <utility>
 #include <iostream>
 #include <unordered_map>
 #include <limits>
 #include <cmath>
 #include <vector>
 #include <set>
+#include <map>
+#include <chrono>
+#include <memory>
 
 struct CORS
 {
@@ -40,248 +52,1058 @@ struct CORS
     }
 };
 
-// Load node coordinates 
-void loadNodeCoordinates(Graph &g, const std::string &filename)
+// Request count, errors and latency of every route, plus requests in
+// flight. Registered first so its timer also covers the CORS middleware.
+struct RequestMetrics
 {
-    std::ifstream in(filename);
-    if (!in.is_open())
+    struct context
     {
-        std::cerr << " Failed to open " << filename << std::endl;
-        return;
-    }
-
-    std::string line;
-    std::getline(in, line); // skip header
+        std::chrono::steady_clock::time_point start;
+    };
 
-    while (std::getline(in, line))
+    struct Endpoint
     {
-        std::stringstream ss(line);
-        std::string idStr, latStr, lonStr;
-        if (!std::getline(ss, idStr, ',')) continue;
-        if (!std::getline(ss, latStr, ',')) continue;
-        if (!std::getline(ss, lonStr, ',')) continue;
+        metrics::Counter requests;
+        metrics::Counter clientErrors;
+        metrics::Counter serverErrors;
+        metrics::Histogram duration;
 
-        try
-        {
-            long long id = std::stoll(idStr);
-            double lat = std::stod(latStr);
-            double lon = std::stod(lonStr);
-            g.addNode(id, lat, lon);
-        }
-        catch (...) { continue; }
-    }
+        explicit Endpoint(const std::string &name)
+            : requests("minimap_http_requests_total", "HTTP requests handled", "endpoint=\"" + name + "\""),
+              clientErrors("minimap_http_errors_total", "HTTP responses with an error status",
+                           "endpoint=\"" + name + "\",class=\"4xx\""),
+              serverErrors("minimap_http_errors_total", "HTTP responses with an error status",
+                           "endpoint=\"" + name + "\",class=\"5xx\""),
+              duration("minimap_http_request_duration_seconds", "Time from request parsed to response ready",
+                       metrics::latencyBuckets(), "endpoint=\"" + name + "\"") {}
+    };
 
-    std::cout << " Node coordinates loaded from " << filename << std::endl;
-}
+    metrics::Gauge inFlight{"minimap_http_requests_in_flight", "Requests currently being handled"};
+    std::map<std::string, std::unique_ptr<Endpoint>> endpoints; // by path
+    std::unique_ptr<Endpoint> other{new Endpoint("other")};     // unknown paths, one series
 
-// Load graph edges 
-Graph loadGraph(const std::string& filename, Graph& g) {
-    std::ifstream in(filename);
-    if (!in.is_open()) {
-        std::cerr << " Failed to open " << filename << std::endl;
-        return g;
+    RequestMetrics()
+    {
+        for (const char *path : {"/", "/shortest-path", "/route", "/trip", "/snap", "/matrix", "/isochrone", "/metrics"})
+            endpoints[path].reset(new Endpoint(path));
     }
 
-    std::string line;
-    long long currentNode = -1;
-
-    while (std::getline(in, line)) {
-        if (line.empty()) continue;
-        std::stringstream ss(line);
-        std::string token;
-        ss >> token;
-
-        if (token == "Node:") {
-            ss >> currentNode;
-            if (!g.get_nodes().count(currentNode))
-                g.addNode(currentNode, 0, 0); // placeholder
-        } else {
-            long long neighbor = std::stoll(token);
-            double weight; ss >> weight;
+    void before_handle(crow::request &req, crow::response &res, context &ctx)
+    {
+        ctx.start = std::chrono::steady_clock::now();
+        inFlight.inc();
+    }
 
-            if (!g.get_nodes().count(neighbor))
-                g.addNode(neighbor, 0, 0); // placeholder
+    void after_handle(crow::request &req, crow::response &res, context &ctx)
+    {
+        auto it = endpoints.find(req.url);
+        const Endpoint &e = it != endpoints.end() ? *it->second : *other;
+        e.requests.inc();
+        if (res.code >= 500) e.serverErrors.inc();
+        else if (res.code >= 400) e.clientErrors.inc();
 
-            g.adEdge(currentNode, neighbor, weight);
-        }
+        // Crow answers some requests (e.g. CORS preflights) without calling
+        // before_handle; the context is per connection, so a start time
+        // left over from an earlier request must not be reused.
+        if (ctx.start == std::chrono::steady_clock::time_point()) return;
+        e.duration.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - ctx.start).count());
+        ctx.start = std::chrono::steady_clock::time_point();
+        inFlight.dec();
     }
+};
 
-    std::cout << " Graph edges loaded from " << filename << std::endl;
-    return g;
-}
+// Sends Crow's own messages through the async logger. Crow's per-request
+// access lines are Info there; they are demoted to debug here.
+struct CrowLogBridge : crow::ILogHandler
+{
+    void log(const std::string &message, crow::LogLevel level) override
+    {
+        logging::Level l = level == crow::LogLevel::Debug || level == crow::LogLevel::Info ? logging::Level::Debug
+                         : level == crow::LogLevel::Warning ? logging::Level::Warning : logging::Level::Error;
+        LOG_AT(l) << message << logging::kv("source", "crow");
+    }
+};
 
 int main()
 {
-    crow::App<CORS> app;
+    // LOG_LEVEL=debug|info|warning|error (default info)
+    const char *levelEnv = std::getenv("LOG_LEVEL");
+    logging::Level level = logging::Level::Info;
+    if (levelEnv && !logging::parseLevel(levelEnv, level))
+        std::cerr << " Unknown LOG_LEVEL " << levelEnv << ", using info" << std::endl;
+    logging::setLevel(level);
+
+    static CrowLogBridge crowLog;
+    crow::logger::setHandler(&crowLog);
+
+    crow::App<RequestMetrics, CORS> app;
+    app.loglevel(level == logging::Level::Debug ? crow::LogLevel::Info : crow::LogLevel::Warning);
+
+    // Per-stage timings of /shortest-path
+    const metrics::Histogram snapSeconds("minimap_route_snap_seconds", "Endpoint snapping time per route request",
+                                         metrics::latencyBuckets());
+    const metrics::Histogram searchSeconds("minimap_route_search_seconds", "Search time per route request",
+                                           metrics::latencyBuckets());
+    const metrics::Histogram serializeSeconds("minimap_route_serialize_seconds", "Response building time per route request",
+                                              metrics::latencyBuckets());
+    const metrics::Histogram settledNodes("minimap_route_settled_nodes", "Nodes settled per route search",
+                                          metrics::countBuckets());
 
     Graph g;
-    loadNodeCoordinates(g, "nodes.csv");
-    loadGraph("nodes.txt", g);
+    KDTree kdt;
 
-    g.buildNodeIndexMapping();
-    std::cout << " Node index mapping built. Total indexed nodes: " << g.indexToId.size() << std::endl;
+    // Binary snapshot written by snapshot_build (GRAPH_SNAPSHOT, default
+    // graph.bin); falls back to the text files when it is missing or stale.
+    // SNAPSHOT_VERIFY=1 checksums the mapped payload before using it.
+    const char *snapEnv = std::getenv("GRAPH_SNAPSHOT");
+    const char *verifyEnv = std::getenv("SNAPSHOT_VERIFY");
+    if (!loadRoutingData(g, kdt, snapEnv ? snapEnv : "graph.bin", "nodes.csv", "nodes.txt",
+                         verifyEnv && std::string(verifyEnv) == "1"))
+        LOG_WARNING << "Graph is empty";
+
+    const CSRGraph &csr = g.get_csr();
+    LOG_INFO << "CSR graph ready" << logging::kv("nodes", csr.numNodes()) << logging::kv("directed_edges", csr.numEdges())
+             << logging::kv("mb", csr.memoryBytes() / (1024 * 1024));
+
+    // Node snapping backend: the KD-tree (default, free with the snapshot)
+    // or a uniform grid over the same points (SPATIAL_INDEX=grid).
+    const char *spatialEnv = std::getenv("SPATIAL_INDEX");
+    const bool useGrid = spatialEnv && std::string(spatialEnv) == "grid";
+    GridIndex grid;
+    if (useGrid) {
+        buildGridIndex(csr, grid);
+        kdt = KDTree();
+        LOG_INFO << "Grid index built" << logging::kv("points", grid.size()) << logging::kv("cell_m", grid.cellMeters())
+                 << logging::kv("mb", grid.memoryBytes() / (1024 * 1024));
+    } else {
+        LOG_INFO << "KD-tree ready" << logging::kv("points", kdt.size()) << logging::kv("mb", kdt.memoryBytes() / (1024 * 1024));
+    }
+    auto snapKNearest = [&](double lat, double lng, int k, uint8_t required) {
+        return useGrid ? grid.kNearestFlagged(lat, lng, k, required) : kdt.kNearestFlagged(lat, lng, k, required);
+    };
+    auto snapBatch = [&](const std::vector<std::pair<double, double>> &queries, uint8_t required, int threads) {
+        return useGrid ? grid.nearestBatch(queries, required, threads) : kdt.nearestBatch(queries, required, threads);
+    };
+    auto snapKBatch = [&](const std::vector<std::pair<double, double>> &queries, int k, uint8_t required, int threads) {
+        return useGrid ? grid.kNearestBatch(queries, k, required, threads) : kdt.kNearestBatch(queries, k, required, threads);
+    };
 
     Algorithms algo;
 
-    // Build KD-tree from graph nodes 
-    std::vector<KDPoint> kdpoints;
-    kdpoints.reserve(g.get_nodes().size());
-    for (const auto &p : g.get_nodes()) {
-        long long id = p.first;
-        const Node &node = p.second;
-        KDPoint kp;
-        kp.id = id;
-        kp.lat = node.get_latitude();
-        kp.lon = node.get_longitude();
-        kdpoints.push_back(kp);
+    LOG_INFO << "Connected components" << logging::kv("count", csr.numComponents())
+             << logging::kv("largest_nodes", csr.componentSize(csr.largestComponent()));
+
+    // Contraction hierarchy written offline by ch_build; enables "mode": "ch"
+    const char *chEnv = std::getenv("CH_FILE");
+    const std::string chFile = chEnv ? chEnv : "graph.ch";
+    ContractionHierarchy ch;
+    if (ch.load(chFile, csr))
+        LOG_INFO << "Contraction hierarchy loaded" << logging::kv("file", chFile) << logging::kv("shortcuts", ch.numShortcuts());
+    else
+        LOG_WARNING << "No usable contraction hierarchy, mode ch disabled" << logging::kv("file", chFile);
+
+    // ALT landmarks for "mode": "alt" (LANDMARKS=0 disables them)
+    const char *lmEnv = std::getenv("LANDMARKS");
+    const int landmarkCount = lmEnv ? std::atoi(lmEnv) : 16;
+    Landmarks landmarks;
+    landmarks.build(csr, landmarkCount, SearchContext::local());
+    LOG_INFO << "Landmarks selected" << logging::kv("count", landmarks.count())
+             << logging::kv("mb", landmarks.memoryBytes() / (1024 * 1024));
+
+    // SNAP_LARGEST_COMPONENT=1 snaps every endpoint onto the largest component,
+    // so small islands in the OSM extract are never chosen.
+    const char *largestEnv = std::getenv("SNAP_LARGEST_COMPONENT");
+    const bool snapLargestOnly = largestEnv && std::string(largestEnv) == "1";
+
+    // Segment index for snapping onto the closest point of a road
+    // ("snap": "edge"); SNAP_EDGES=0 skips it and falls back to nodes.
+    const char *edgeEnv = std::getenv("SNAP_EDGES");
+    EdgeIndex edgeIndex;
+    if (!(edgeEnv && std::string(edgeEnv) == "0")) {
+        edgeIndex.build(csr);
+        LOG_INFO << "Edge index built" << logging::kv("segments", edgeIndex.numEdges())
+                 << logging::kv("mb", edgeIndex.memoryBytes() / (1024 * 1024));
     }
 
-    KDTree kdt;
-    kdt.build(kdpoints); 
+    // Search results by snapped seeds and mode (ROUTE_CACHE_MB, 0 disables)
+    const char *cacheEnv = std::getenv("ROUTE_CACHE_MB");
+    const size_t cacheMb = cacheEnv ? (size_t)std::atoll(cacheEnv) : 64;
+    RouteCache routeCache(cacheMb * 1024 * 1024);
+    routeCache.bindGraph(csr.fingerprint());
+    LOG_INFO << "Route cache" << logging::kv("mb", cacheMb);
+
+    // Candidates per endpoint for node snapping; all of them seed a single search
+    const int K = 16;
+
+    // K nearest candidates, each costed by its straight-line snap distance
+    auto snapCandidates = [&](double lat, double lng, bool largestOnly) {
+        std::vector<SearchEndpoint> out;
+        // Main component nodes always have neighbours; otherwise only
+        // skip nodes without edges. Either filter is one flag test.
+        auto ids = snapKNearest(lat, lng, K, largestOnly ? SNAP_MAIN_COMPONENT : SNAP_HAS_NEIGHBOURS);
+        for (long long idx : ids)
+            out.push_back({(int)idx, CSRGraph::haversine(lat, lng, csr.lat((int)idx), csr.lon((int)idx))});
+        return out;
+    };
+
+    // Both ends of a snapped segment, each seeded with the along-edge part
+    // as an offset that counts toward the distance
+    auto edgeEndpoints = [](const EdgeSnap &e) {
+        return std::vector<SearchEndpoint>{{e.u, e.distance + e.costToU(), e.costToU()},
+                                           {e.v, e.distance + e.costToV(), e.costToV()}};
+    };
+
+    // One search from every start candidate that stops at the first settled
+    // end candidate. Requests that snap to exactly the same seeds (the same
+    // place picked twice) reuse the stored result.
+    auto searchBetween = [&](const std::string &mode, const std::vector<SearchEndpoint> &from,
+                             const std::vector<SearchEndpoint> &to, bool &cached) {
+        const std::string cacheKey = RouteCache::key(mode, from, to);
+        const uint64_t cacheEpoch = routeCache.epochNow();
+        cached = false;
+        if (auto hit = routeCache.get(cacheKey)) {
+            cached = true;
+            return *hit;
+        }
+        PathResult best;
+        if (mode == "ch")
+            best = ch.query(csr, from, to, SearchContext::local());
+        else if (mode == "alt")
+            best = algo.AstarALT(csr, landmarks, from, to, SearchContext::local());
+        else if (mode == "bidijkstra")
+            best = algo.BidirectionalDijkstraMulti(csr, from, to, SearchContext::local());
+        else if (mode == "biastar")
+            best = algo.BidirectionalAstarMulti(csr, from, to, SearchContext::local());
+        else
+            best = algo.AstarMulti(csr, from, to, SearchContext::local());
+        searchSeconds.observe(best.stats.timeMs / 1000.0);
+        settledNodes.observe((double)best.stats.settled);
+        routeCache.put(cacheKey, best, cacheEpoch);
+        return best;
+    };
+
+    // Both points on the same segment: the piece between them may be
+    // shorter than leaving the edge through either end.
+    auto joinAlongEdge = [&](PathResult &best, const EdgeSnap &a, const EdgeSnap &b) {
+        if (!a.sameEdge(b)) return;
+        double bt = b.u == a.u ? b.t : 1.0 - b.t;
+        double direct = std::fabs(a.t - bt) * a.weight;
+        if (best.found && direct > best.distance) return;
+        PathResult along;
+        along.found = true;
+        along.distance = direct;
+        along.stats = best.stats;
+        long long nearEnd = csr.id(a.t < 0.5 ? a.u : a.v);
+        along.nodes = {nearEnd, nearEnd};
+        best = std::move(along);
+    };
+
+    // Type checks for request fields; reading a field as the wrong type
+    // throws, which would otherwise come back as a 500
+    auto isNumber = [](const crow::json::rvalue &v) { return v.t() == crow::json::type::Number; };
+    auto isString = [](const crow::json::rvalue &v) { return v.t() == crow::json::type::String; };
+    auto isBool = [](const crow::json::rvalue &v) {
+        return v.t() == crow::json::type::True || v.t() == crow::json::type::False;
+    };
+    // {"lat": number, "lng": number}
+    auto isPoint = [&](const crow::json::rvalue &v) {
+        return v.t() == crow::json::type::Object && v.has("lat") && v.has("lng") && isNumber(v["lat"]) && isNumber(v["lng"]);
+    };
 
     // Health check
     CROW_ROUTE(app, "/")([]() { return " Server is running!"; });
 
+    // Prometheus scrape target
+    CROW_ROUTE(app, "/metrics")([]()
+    {
+        crow::response res(metrics::render());
+        res.add_header("Content-Type", "text/plain; version=0.0.4");
+        return res;
+    });
+
     // Shortest path route
     CROW_ROUTE(app, "/shortest-path").methods("POST"_method)([&](const crow::request &req)
     {
         try {
             auto body = crow::json::load(req.body);
-            if (!body || !body.has("start") || !body.has("end") ||
-                !body["start"].has("lat") || !body["start"].has("lng") ||
-                !body["end"].has("lat") || !body["end"].has("lng"))
+            if (!body || body.t() != crow::json::type::Object || !body.has("start") || !body.has("end") ||
+                !isPoint(body["start"]) || !isPoint(body["end"]))
             {
-                return crow::response(400, "Invalid JSON or missing start/end lat/lng");
+                return crow::response(400, "Invalid JSON or missing numeric start/end lat/lng");
             }
+            if ((body.has("mode") && !isString(body["mode"])) || (body.has("snap") && !isString(body["snap"])))
+                return crow::response(400, "mode and snap must be strings");
 
             double startLat = body["start"]["lat"].d();
             double startLng = body["start"]["lng"].d();
             double endLat   = body["end"]["lat"].d();
             double endLng   = body["end"]["lng"].d();
 
-            // Tune K as needed (8..32)
-            const int K = 8;
+            // Query engine: "astar" (default), "alt", "bidijkstra", "biastar" or "ch"
+            std::string mode = body.has("mode") ? std::string(body["mode"].s()) : "astar";
+            if (mode != "astar" && mode != "alt" && mode != "bidijkstra" && mode != "biastar" && mode != "ch")
+                return crow::response(400, "Unknown mode, expected astar, alt, bidijkstra, biastar or ch");
+            if (mode == "ch" && ch.empty())
+                return crow::response(400, "Contraction hierarchy not loaded");
+            if (mode == "alt" && landmarks.empty())
+                return crow::response(400, "Landmarks not built");
+
+            // Endpoint snapping: "edge" (closest point on the closest road
+            // segment, the default when the edge index is built) or "node"
+            // (the K nearest graph nodes)
+            std::string snap = body.has("snap") ? std::string(body["snap"].s()) : (edgeIndex.empty() ? "node" : "edge");
+            if (snap != "edge" && snap != "node")
+                return crow::response(400, "Unknown snap, expected edge or node");
+            if (snap == "edge" && edgeIndex.empty())
+                return crow::response(400, "Edge index not built");
 
-            // Valid predicate for KD-tree: exclude nodes with no neighbors
-            auto validPredicate = [&](long long id) -> bool {
-                const auto &neighbors = g.getNeighbors(id);
-                return !neighbors.empty();
+            auto sharesComponent = [&](const std::vector<SearchEndpoint> &a, const std::vector<SearchEndpoint> &b) {
+                for (const auto &x : a)
+                    for (const auto &y : b)
+                        if (csr.connected(x.node, y.node)) return true;
+                return false;
             };
 
-            // Get K nearest candidates for start and end
-            auto startCandidates = kdt.kNearest(startLat, startLng, K, [&](long long id){
-                // also require node exists and has neighbors
-                if (!g.hasNode(id)) return false;
-                return validPredicate(id);
-            });
+            std::vector<SearchEndpoint> startCandidates, endCandidates;
+            EdgeSnap startEdge, endEdge;
+            auto snapStart = std::chrono::steady_clock::now();
+            if (snap == "edge") {
+                startEdge = edgeIndex.nearest(csr, startLat, startLng, snapLargestOnly);
+                endEdge = edgeIndex.nearest(csr, endLat, endLng, snapLargestOnly);
+                if (!snapLargestOnly && startEdge.found() && endEdge.found() && !csr.connected(startEdge.u, endEdge.u)) {
+                    startEdge = edgeIndex.nearest(csr, startLat, startLng, true);
+                    endEdge = edgeIndex.nearest(csr, endLat, endLng, true);
+                }
+                if (!startEdge.found() || !endEdge.found())
+                    return crow::response(500, "Failed to find nearest road");
+                startCandidates = edgeEndpoints(startEdge);
+                endCandidates = edgeEndpoints(endEdge);
+            } else {
+                startCandidates = snapCandidates(startLat, startLng, snapLargestOnly);
+                endCandidates = snapCandidates(endLat, endLng, snapLargestOnly);
 
-            auto endCandidates = kdt.kNearest(endLat, endLng, K, [&](long long id){
-                if (!g.hasNode(id)) return false;
-                return validPredicate(id);
-            });
+                // Candidates on disjoint islands can never be joined; redirect
+                // both endpoints onto the largest component instead of searching.
+                if (!snapLargestOnly && !sharesComponent(startCandidates, endCandidates)) {
+                    startCandidates = snapCandidates(startLat, startLng, true);
+                    endCandidates = snapCandidates(endLat, endLng, true);
+                }
+            }
 
+            snapSeconds.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - snapStart).count());
             if (startCandidates.empty() || endCandidates.empty()) {
                 return crow::response(500, "Failed to find nearest connected nodes");
             }
 
-            double totalDistance = std::numeric_limits<double>::infinity();
-            long long chosenStart = -1, chosenEnd = -1;
-
-            // Try A* on pairs of candidates until a path is found.
-            // We keep the behavior "try multiple nearest" but avoid scanning entire graph.
-            bool found = false;
-            for (long long sId : startCandidates) {
-                for (long long eId : endCandidates) {
-                    // optional short-circuit: same node
-                    if (sId == eId) {
-                        // small sanity check: still run A* to ensure it's valid
+            bool cached = false;
+            PathResult best = searchBetween(mode, startCandidates, endCandidates, cached);
+            if (snap == "edge") joinAlongEdge(best, startEdge, endEdge);
+
+            if (!best.found)
+                return crow::response(500, "No path found between nearest candidates");
+
+            long long chosenStart = best.nodes.front();
+            long long chosenEnd   = best.nodes.back();
+
+            // The route starts and ends at the snapped points on the road
+            if (snap == "edge") {
+                best.coordinates.insert(best.coordinates.begin(), {startEdge.lat, startEdge.lon});
+                best.coordinates.push_back({endEdge.lat, endEdge.lon});
+            }
+
+            LOG_DEBUG << "Route served" << logging::kv("mode", mode) << logging::kv("snap", snap)
+                      << logging::kv("distance_m", best.distance) << logging::kv("settled", best.stats.settled)
+                      << logging::kv("search_ms", best.stats.timeMs) << logging::kv("cached", cached);
+
+            metrics::ScopedTimer serializeTimer(serializeSeconds);
+            crow::json::wvalue result;
+            std::vector<crow::json::wvalue> path;
+            path.reserve(best.coordinates.size());
+            for (const auto &p : best.coordinates) {
+                crow::json::wvalue pt;
+                pt["lat"] = p.lat;
+                pt["lng"] = p.lon;
+                path.push_back(std::move(pt));
+            }
+            result["path"] = std::move(path);
+
+            result["distance_meters"] = best.distance;
+            result["start_node"] = chosenStart;
+            result["end_node"]   = chosenEnd;
+            result["settled_nodes"] = best.stats.settled;
+            result["search_ms"] = best.stats.timeMs;
+            result["mode"] = mode;
+            result["snap"] = snap;
+            result["cached"] = cached;
+
+            crow::response res(result);
+            res.add_header("Content-Type", "application/json");
+            return res;
+
+        } catch (const std::exception& e) {
+            LOG_ERROR << "Request failed" << logging::kv("error", std::string(e.what()));
+            return crow::response(500, "Internal server error");
+        }
+    });
+
+    // Multi-stop route: {"waypoints": [{"lat", "lng"}, ...], "mode", "snap"}
+    // -> one polyline through every waypoint in order, with per-leg distances.
+    // All points are snapped in one batch and the legs searched in parallel.
+    CROW_ROUTE(app, "/route").methods("POST"_method)([&](const crow::request &req)
+    {
+        try {
+            auto body = crow::json::load(req.body);
+            if (!body || body.t() != crow::json::type::Object || !body.has("waypoints") ||
+                body["waypoints"].t() != crow::json::type::List)
+                return crow::response(400, "Invalid JSON or missing waypoints array");
+            const auto &list = body["waypoints"];
+            const size_t MAX_WAYPOINTS = 200;
+            if (list.size() < 2 || list.size() > MAX_WAYPOINTS)
+                return crow::response(400, "Expected 2 to " + std::to_string(MAX_WAYPOINTS) + " waypoints");
+            std::vector<std::pair<double, double>> queries;
+            for (size_t i = 0; i < list.size(); i++) {
+                if (!isPoint(list[i]))
+                    return crow::response(400, "Waypoint " + std::to_string(i) + " needs numeric lat and lng");
+                queries.push_back({list[i]["lat"].d(), list[i]["lng"].d()});
+            }
+            if ((body.has("mode") && !isString(body["mode"])) || (body.has("snap") && !isString(body["snap"])))
+                return crow::response(400, "mode and snap must be strings");
+
+            std::string mode = body.has("mode") ? std::string(body["mode"].s()) : "astar";
+            if (mode != "astar" && mode != "alt" && mode != "bidijkstra" && mode != "biastar" && mode != "ch")
+                return crow::response(400, "Unknown mode, expected astar, alt, bidijkstra, biastar or ch");
+            if (mode == "ch" && ch.empty())
+                return crow::response(400, "Contraction hierarchy not loaded");
+            if (mode == "alt" && landmarks.empty())
+                return crow::response(400, "Landmarks not built");
+            std::string snap = body.has("snap") ? std::string(body["snap"].s()) : (edgeIndex.empty() ? "node" : "edge");
+            if (snap != "edge" && snap != "node")
+                return crow::response(400, "Unknown snap, expected edge or node");
+            if (snap == "edge" && edgeIndex.empty())
+                return crow::response(400, "Edge index not built");
+
+            const size_t W = queries.size(), legs = W - 1;
+            std::vector<std::vector<SearchEndpoint>> seeds(W);
+            std::vector<EdgeSnap> edges(W);
+            auto snapAll = [&](bool largestOnly) {
+                if (snap == "edge") {
+                    for (size_t i = 0; i < W; i++) {
+                        edges[i] = edgeIndex.nearest(csr, queries[i].first, queries[i].second, largestOnly);
+                        seeds[i] = edges[i].found() ? edgeEndpoints(edges[i]) : std::vector<SearchEndpoint>();
                     }
+                    return;
+                }
+                auto ids = snapKBatch(queries, K, largestOnly ? SNAP_MAIN_COMPONENT : SNAP_HAS_NEIGHBOURS, 1);
+                for (size_t i = 0; i < W; i++) {
+                    seeds[i].clear();
+                    for (long long idx : ids[i])
+                        seeds[i].push_back({(int)idx, CSRGraph::haversine(queries[i].first, queries[i].second,
+                                                                          csr.lat((int)idx), csr.lon((int)idx))});
+                }
+            };
+            // Any leg whose ends lie on disjoint islands moves every waypoint
+            // onto the largest component, as /shortest-path does for its pair
+            auto legJoinable = [&](size_t i) {
+                for (const auto &x : seeds[i])
+                    for (const auto &y : seeds[i + 1])
+                        if (csr.connected(x.node, y.node)) return true;
+                return false;
+            };
+            {
+                metrics::ScopedTimer snapTimer(snapSeconds);
+                snapAll(snapLargestOnly);
+                bool joinable = true;
+                for (size_t i = 0; i < legs && joinable; i++) joinable = legJoinable(i);
+                if (!snapLargestOnly && !joinable) snapAll(true);
+            }
+            for (size_t i = 0; i < W; i++)
+                if (seeds[i].empty())
+                    return crow::response(500, "Failed to find nearest road for waypoint " + std::to_string(i));
+
+            // Legs are independent; they run on the request thread and the
+            // shared pool, each thread searching with its own long-lived context
+            std::vector<PathResult> results(legs);
+            std::vector<uint8_t> cachedLeg(legs, 0);
+            auto startTime = std::chrono::steady_clock::now();
+            WorkerPool::shared().run(legs, (int)legs, [&](int, size_t b, size_t e) {
+                for (size_t i = b; i < e; i++) {
+                    bool cached = false;
+                    results[i] = searchBetween(mode, seeds[i], seeds[i + 1], cached);
+                    cachedLeg[i] = cached;
+                    if (snap == "edge") joinAlongEdge(results[i], edges[i], edges[i + 1]);
+                }
+            });
+            double searchMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+            for (size_t i = 0; i < legs; i++)
+                if (!results[i].found)
+                    return crow::response(500, "No path found for leg " + std::to_string(i));
+
+            // Legs are joined at the snapped waypoints; a leg's first point
+            // is dropped when it repeats the previous leg's last one
+            metrics::ScopedTimer serializeTimer(serializeSeconds);
+            std::string out, legsJson;
+            char num[96];
+            out.reserve(4096);
+            out += "{\"path\":[";
+            size_t points = 0;
+            PathPoint last{0.0, 0.0};
+            double total = 0.0;
+            long long settled = 0;
+            auto addPoint = [&](double lat, double lng) {
+                snprintf(num, sizeof(num), points ? ",{\"lat\":%.7f,\"lng\":%.7f}" : "{\"lat\":%.7f,\"lng\":%.7f}", lat, lng);
+                out += num;
+                points++;
+                last = {lat, lng};
+            };
+            for (size_t i = 0; i < legs; i++) {
+                const PathResult &r = results[i];
+                const size_t legStart = points ? points - 1 : 0;
+                std::vector<PathPoint> coords;
+                if (snap == "edge") coords.push_back({edges[i].lat, edges[i].lon});
+                coords.insert(coords.end(), r.coordinates.begin(), r.coordinates.end());
+                if (snap == "edge") coords.push_back({edges[i + 1].lat, edges[i + 1].lon});
+                for (size_t j = 0; j < coords.size(); j++) {
+                    if (j == 0 && points && coords[0].lat == last.lat && coords[0].lon == last.lon) continue;
+                    addPoint(coords[j].lat, coords[j].lon);
+                }
+
+                total += r.distance;
+                settled += r.stats.settled;
+                snprintf(num, sizeof(num), "%s{\"distance_meters\":%.3f,\"path_start\":%zu,\"settled_nodes\":%lld,",
+                         i ? "," : "", r.distance, legStart, r.stats.settled);
+                legsJson += num;
+                legsJson += cachedLeg[i] ? "\"cached\":true}" : "\"cached\":false}";
+            }
+            out += "],\"legs\":[" + legsJson;
+            snprintf(num, sizeof(num), "],\"distance_meters\":%.3f,\"settled_nodes\":%lld,\"search_ms\":%.3f,",
+                     total, settled, searchMs);
+            out += num;
+            out += "\"mode\":\"" + mode + "\",\"snap\":\"" + snap + "\"}";
+
+            LOG_DEBUG << "Multi-stop route served" << logging::kv("mode", mode) << logging::kv("legs", legs)
+                      << logging::kv("distance_m", total) << logging::kv("search_ms", searchMs);
+
+            crow::response res(std::move(out));
+            res.add_header("Content-Type", "application/json");
+            return res;
 
-                    // call A* 
-                    double dist = algo.Astar(g, sId, eId);
+        } catch (const std::exception& e) {
+            LOG_ERROR << "Request failed" << logging::kv("error", std::string(e.what()));
+            return crow::response(500, "Internal server error");
+        }
+    });
 
-                    if (dist != std::numeric_limits<double>::infinity()) {
-                        totalDistance = dist;
-                        chosenStart = sId;
-                        chosenEnd   = eId;
-                        found = true;
-                        break;
+    // Stop ordering: {"waypoints": [...], "roundtrip": bool, "time_limit_ms"}
+    // -> the visiting order that keeps the first waypoint first and (unless
+    // roundtrip) the last one last. Distances come from the matrix engines;
+    // the order from nearest insertion refined by 2-opt and Or-opt.
+    CROW_ROUTE(app, "/trip").methods("POST"_method)([&](const crow::request &req)
+    {
+        try {
+            auto body = crow::json::load(req.body);
+            if (!body || body.t() != crow::json::type::Object || !body.has("waypoints") ||
+                body["waypoints"].t() != crow::json::type::List)
+                return crow::response(400, "Invalid JSON or missing waypoints array");
+            const auto &list = body["waypoints"];
+            const size_t MAX_STOPS = 500;
+            if (list.size() < 2 || list.size() > MAX_STOPS)
+                return crow::response(400, "Expected 2 to " + std::to_string(MAX_STOPS) + " waypoints");
+            std::vector<std::pair<double, double>> queries;
+            for (size_t i = 0; i < list.size(); i++) {
+                if (list[i].t() != crow::json::type::Object || !list[i].has("lat") || !list[i].has("lng") ||
+                    !isNumber(list[i]["lat"]) || !isNumber(list[i]["lng"]))
+                    return crow::response(400, "Every waypoint needs numeric lat and lng");
+                queries.push_back({list[i]["lat"].d(), list[i]["lng"].d()});
+            }
+            if ((body.has("roundtrip") && !isBool(body["roundtrip"])) ||
+                (body.has("time_limit_ms") && !isNumber(body["time_limit_ms"])) ||
+                (body.has("mode") && !isString(body["mode"])) || (body.has("snap") && !isString(body["snap"])) ||
+                (body.has("largest_component") && !isBool(body["largest_component"])))
+                return crow::response(400, "roundtrip and largest_component must be booleans, time_limit_ms a number, "
+                                           "mode and snap strings");
+
+            TourOptions options;
+            if (body.has("roundtrip")) options.roundTrip = body["roundtrip"].b();
+            if (body.has("time_limit_ms")) options.timeLimitMs = std::min(body["time_limit_ms"].d(), 5000.0);
+            std::string mode = body.has("mode") ? std::string(body["mode"].s()) : (ch.empty() ? "dijkstra" : "ch");
+            if (mode != "ch" && mode != "dijkstra")
+                return crow::response(400, "Unknown mode, expected ch or dijkstra");
+            if (mode == "ch" && ch.empty())
+                return crow::response(400, "Contraction hierarchy not loaded");
+            std::string snap = body.has("snap") ? std::string(body["snap"].s()) : (edgeIndex.empty() ? "node" : "edge");
+            if (snap != "edge" && snap != "node")
+                return crow::response(400, "Unknown snap, expected edge or node");
+            if (snap == "edge" && edgeIndex.empty())
+                return crow::response(400, "Edge index not built");
+            bool largestOnly = snapLargestOnly;
+            if (body.has("largest_component")) largestOnly = body["largest_component"].b();
+
+            // One seed set per stop: both ends of the snapped segment or the
+            // nearest node. Stops that cannot all reach each other move onto
+            // the largest component.
+            const size_t n = queries.size();
+            std::vector<std::vector<SearchEndpoint>> seeds(n);
+            std::vector<EdgeSnap> edges(n);
+            std::vector<PathPoint> snapped(n);
+            auto snapAll = [&](bool largestOnly) {
+                std::vector<long long> ids;
+                if (snap == "node")
+                    ids = snapBatch(queries, largestOnly ? SNAP_MAIN_COMPONENT : SNAP_HAS_NEIGHBOURS, 1);
+                for (size_t i = 0; i < n; i++) {
+                    seeds[i].clear();
+                    if (snap == "edge") {
+                        edges[i] = edgeIndex.nearest(csr, queries[i].first, queries[i].second, largestOnly);
+                        if (!edges[i].found()) continue;
+                        seeds[i] = {{edges[i].u, 0.0, edges[i].costToU()}, {edges[i].v, 0.0, edges[i].costToV()}};
+                        snapped[i] = {edges[i].lat, edges[i].lon};
+                    } else if (ids[i] >= 0) {
+                        seeds[i] = {{(int)ids[i], 0.0, 0.0}};
+                        snapped[i] = {csr.lat((int)ids[i]), csr.lon((int)ids[i])};
                     }
-                    // else try next end candidate
                 }
-                if (found) break;
+            };
+            {
+                metrics::ScopedTimer snapTimer(snapSeconds);
+                snapAll(largestOnly);
+                bool joinable = true;
+                for (size_t i = 1; i < n && joinable; i++)
+                    joinable = !seeds[i].empty() && !seeds[0].empty() && csr.connected(seeds[0][0].node, seeds[i][0].node);
+                if (!largestOnly && !joinable) snapAll(true);
             }
+            for (size_t i = 0; i < n; i++)
+                if (seeds[i].empty())
+                    return crow::response(500, "Failed to find nearest road for waypoint " + std::to_string(i));
 
-            if (!found) {
-                // If no path found among top-K candidates, you can choose to:
-                //  - increase K and retry
-                //  - or fallback to original scan behaviour (try nearest one-by-one).
-                // For now, we will expand K progressively once (doubling) up to a reasonable cap.
-                int newK = std::min((int)g.get_nodes().size(), K * 4);
-                if (newK > K) {
-                    auto startCandidates2 = kdt.kNearest(startLat, startLng, newK, [&](long long id){
-                        if (!g.hasNode(id)) return false;
-                        return validPredicate(id);
-                    });
-                    auto endCandidates2 = kdt.kNearest(endLat, endLng, newK, [&](long long id){
-                        if (!g.hasNode(id)) return false;
-                        return validPredicate(id);
-                    });
-
-                    for (long long sId : startCandidates2) {
-                        for (long long eId : endCandidates2) {
-                            double dist = algo.Astar(g, sId, eId);
-                            if (dist != std::numeric_limits<double>::infinity()) {
-                                totalDistance = dist;
-                                chosenStart = sId;
-                                chosenEnd   = eId;
-                                found = true;
-                                break;
-                            }
-                        }
-                        if (found) break;
+            auto startTime = std::chrono::steady_clock::now();
+            const int threads = std::min(defaultThreadCount(), (int)(n / 4) + 1);
+            std::vector<double> matrix = mode == "ch" ? ch.distanceMatrix(csr, seeds, seeds, threads)
+                                                      : Algorithms::distanceMatrix(csr, seeds, seeds, threads);
+            for (size_t i = 0; i < n; i++) {
+                matrix[i * n + i] = 0.0;
+                for (size_t j = 0; j < n; j++) {
+                    if (snap == "edge" && edges[i].sameEdge(edges[j])) {
+                        double bt = edges[j].u == edges[i].u ? edges[j].t : 1.0 - edges[j].t;
+                        matrix[i * n + j] = std::min(matrix[i * n + j], std::fabs(edges[i].t - bt) * edges[i].weight);
                     }
+                    // The stops are fine as JSON but cannot all be visited
+                    if (std::isinf(matrix[i * n + j]))
+                        return crow::response(422, "No path between waypoints " + std::to_string(i) + " and " + std::to_string(j));
                 }
             }
+            double matrixMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
 
-            if (!found)
-                return crow::response(500, "No path found between nearest candidates");
+            startTime = std::chrono::steady_clock::now();
+            TourResult tour = solveTour(matrix, n, options);
+            double solveMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
 
-            // Read path coordinates from file (preserving your existing Algo/printPath CSV behavior)
-            std::ifstream pathFile("path_cordinates.csv");
-            if (!pathFile.is_open()) return crow::response(500, "Failed to read path coordinates");
+            metrics::ScopedTimer serializeTimer(serializeSeconds);
+            std::string out = "{\"order\":[";
+            char num[128];
+            for (size_t k = 0; k < tour.order.size(); k++) {
+                snprintf(num, sizeof(num), k ? ",%d" : "%d", tour.order[k]);
+                out += num;
+            }
+            out += "],\"waypoints\":[";
+            for (size_t k = 0; k < tour.order.size(); k++) {
+                const PathPoint &p = snapped[tour.order[k]];
+                snprintf(num, sizeof(num), k ? ",{\"lat\":%.7f,\"lng\":%.7f}" : "{\"lat\":%.7f,\"lng\":%.7f}", p.lat, p.lon);
+                out += num;
+            }
+            out += "],\"legs\":[";
+            for (size_t k = 0; k + 1 < tour.order.size(); k++) {
+                snprintf(num, sizeof(num), k ? ",%.1f" : "%.1f", matrix[(size_t)tour.order[k] * n + tour.order[k + 1]]);
+                out += num;
+            }
+            snprintf(num, sizeof(num), "],\"distance_meters\":%.1f,\"initial_distance_meters\":%.1f,\"improvements\":%d,",
+                     tour.cost, tour.initialCost, tour.improvements);
+            out += num;
+            snprintf(num, sizeof(num), "\"timed_out\":%s,\"matrix_ms\":%.3f,\"solve_ms\":%.3f,",
+                     tour.timedOut ? "true" : "false", matrixMs, solveMs);
+            out += num;
+            out += "\"mode\":\"" + mode + "\",\"snap\":\"" + snap + "\"}";
 
-            std::string line;
-            std::getline(pathFile, line); // skip header if present
-            crow::json::wvalue result;
-            result["path"] = crow::json::wvalue::list();
-            int idx = 0;
-            while (std::getline(pathFile, line)) {
-                std::stringstream ss(line);
-                std::string latStr, lonStr;
-                if (!std::getline(ss, latStr, ',')) break;
-                if (!std::getline(ss, lonStr, ',')) break;
-                result["path"][idx]["lat"] = std::stod(latStr);
-                result["path"][idx]["lng"] = std::stod(lonStr);
-                idx++;
+            LOG_DEBUG << "Trip served" << logging::kv("stops", n) << logging::kv("distance_m", tour.cost)
+                      << logging::kv("initial_m", tour.initialCost) << logging::kv("matrix_ms", matrixMs)
+                      << logging::kv("solve_ms", solveMs);
+
+            crow::response res(std::move(out));
+            res.add_header("Content-Type", "application/json");
+            return res;
+
+        } catch (const std::exception& e) {
+            LOG_ERROR << "Request failed" << logging::kv("error", std::string(e.what()));
+            return crow::response(500, "Internal server error");
+        }
+    });
+
+    // Batch snapping: {"points": [{"lat", "lng"}, ...], "largest_component": bool}
+    // -> nearest routable node of every point, in input order.
+    CROW_ROUTE(app, "/snap").methods("POST"_method)([&](const crow::request &req)
+    {
+        try {
+            auto body = crow::json::load(req.body);
+            if (!body || body.t() != crow::json::type::Object || !body.has("points") ||
+                body["points"].t() != crow::json::type::List)
+                return crow::response(400, "Invalid JSON or missing points array");
+
+            const size_t MAX_POINTS = 10000;
+            const auto &points = body["points"];
+            if (points.size() > MAX_POINTS)
+                return crow::response(400, "Too many points (max " + std::to_string(MAX_POINTS) + ")");
+
+            std::vector<std::pair<double, double>> queries;
+            queries.reserve(points.size());
+            for (size_t i = 0; i < points.size(); i++) {
+                if (!isPoint(points[i]))
+                    return crow::response(400, "points[" + std::to_string(i) + "] needs numeric lat and lng");
+                queries.push_back({points[i]["lat"].d(), points[i]["lng"].d()});
             }
-            pathFile.close();
+            if (body.has("largest_component") && !isBool(body["largest_component"]))
+                return crow::response(400, "largest_component must be a boolean");
 
-            result["distance_meters"] = totalDistance;
-            result["start_node"] = chosenStart;
-            result["end_node"]   = chosenEnd;
+            bool largestOnly = snapLargestOnly;
+            if (body.has("largest_component")) largestOnly = body["largest_component"].b();
+
+            // Small batches are not worth waking threads for
+            const int threads = std::min(defaultThreadCount(), (int)(queries.size() / 256) + 1);
+            std::vector<long long> nearest = snapBatch(
+                queries, largestOnly ? SNAP_MAIN_COMPONENT : SNAP_HAS_NEIGHBOURS, threads);
+
+            std::vector<crow::json::wvalue> snapped;
+            snapped.reserve(nearest.size());
+            for (size_t i = 0; i < nearest.size(); i++) {
+                crow::json::wvalue pt;
+                int idx = (int)nearest[i];
+                if (idx < 0) {
+                    pt["node"] = nullptr;
+                } else {
+                    pt["node"] = csr.id(idx);
+                    pt["lat"] = csr.lat(idx);
+                    pt["lng"] = csr.lon(idx);
+                    pt["distance_meters"] = CSRGraph::haversine(queries[i].first, queries[i].second, csr.lat(idx), csr.lon(idx));
+                }
+                snapped.push_back(std::move(pt));
+            }
 
+            crow::json::wvalue result;
+            result["snapped"] = std::move(snapped);
             crow::response res(result);
             res.add_header("Content-Type", "application/json");
             return res;
 
         } catch (const std::exception& e) {
-            std::cerr << "Error: " << e.what() << std::endl;
+            LOG_ERROR << "Request failed" << logging::kv("error", std::string(e.what()));
+            return crow::response(500, "Internal server error");
+        }
+    });
+
+    // Distance matrix: {"sources": [{"lat", "lng"}, ...], "targets": [...] (default: sources),
+    // "mode": "ch" | "dijkstra", "snap": "edge" | "node", "largest_component": bool}
+    // -> "distances"[i][j] in meters along the road from source i to target j
+    // (null when unreachable), plus the snapped points.
+    CROW_ROUTE(app, "/matrix").methods("POST"_method)([&](const crow::request &req)
+    {
+        try {
+            auto body = crow::json::load(req.body);
+            if (!body || body.t() != crow::json::type::Object || !body.has("sources") ||
+                body["sources"].t() != crow::json::type::List)
+                return crow::response(400, "Invalid JSON or missing sources array");
+            const bool sameSets = !body.has("targets");
+            if (!sameSets && body["targets"].t() != crow::json::type::List)
+                return crow::response(400, "targets must be an array");
+            const auto &sourceList = body["sources"];
+            const auto &targetList = sameSets ? body["sources"] : body["targets"];
+
+            const size_t MAX_SIDE = 2000, MAX_CELLS = 1000000;
+            if (sourceList.size() > MAX_SIDE || targetList.size() > MAX_SIDE ||
+                sourceList.size() * targetList.size() > MAX_CELLS)
+                return crow::response(400, "Matrix too large (max " + std::to_string(MAX_SIDE) + " per side, "
+                                           + std::to_string(MAX_CELLS) + " cells)");
+            for (const char *side : {"sources", "targets"}) {
+                if (!body.has(side)) continue;
+                for (size_t i = 0; i < body[side].size(); i++)
+                    if (!isPoint(body[side][i]))
+                        return crow::response(400, std::string(side) + "[" + std::to_string(i) + "] needs numeric lat and lng");
+            }
+            if ((body.has("mode") && !isString(body["mode"])) || (body.has("snap") && !isString(body["snap"])) ||
+                (body.has("largest_component") && !isBool(body["largest_component"])))
+                return crow::response(400, "mode and snap must be strings, largest_component a boolean");
+
+            // Bucket many-to-many on the hierarchy when it is loaded,
+            // otherwise one Dijkstra per source
+            std::string mode = body.has("mode") ? std::string(body["mode"].s()) : (ch.empty() ? "dijkstra" : "ch");
+            if (mode != "ch" && mode != "dijkstra")
+                return crow::response(400, "Unknown mode, expected ch or dijkstra");
+            if (mode == "ch" && ch.empty())
+                return crow::response(400, "Contraction hierarchy not loaded");
+            std::string snap = body.has("snap") ? std::string(body["snap"].s()) : (edgeIndex.empty() ? "node" : "edge");
+            if (snap != "edge" && snap != "node")
+                return crow::response(400, "Unknown snap, expected edge or node");
+            if (snap == "edge" && edgeIndex.empty())
+                return crow::response(400, "Edge index not built");
+            bool largestOnly = snapLargestOnly;
+            if (body.has("largest_component")) largestOnly = body["largest_component"].b();
+
+            // Seeds of every point: both ends of the snapped segment with the
+            // along-edge offsets, or the nearest node
+            struct Snapped { std::vector<SearchEndpoint> seeds; EdgeSnap edge; double lat = 0, lng = 0; };
+            // Node mode answers each side with one batched index query
+            auto snapAll = [&](const crow::json::rvalue &list, std::vector<Snapped> &out) {
+                std::vector<std::pair<double, double>> queries(list.size());
+                for (size_t i = 0; i < list.size(); i++) queries[i] = {list[i]["lat"].d(), list[i]["lng"].d()};
+                out.resize(queries.size());
+                std::vector<long long> ids;
+                if (snap != "edge")
+                    ids = snapBatch(queries, largestOnly ? SNAP_MAIN_COMPONENT : SNAP_HAS_NEIGHBOURS,
+                                    std::min(defaultThreadCount(), (int)(queries.size() / 256) + 1));
+                for (size_t i = 0; i < queries.size(); i++) {
+                    const double lat = queries[i].first, lng = queries[i].second;
+                    Snapped &p = out[i];
+                    if (snap == "edge") {
+                        p.edge = edgeIndex.nearest(csr, lat, lng, largestOnly);
+                        if (!p.edge.found()) continue;
+                        p.seeds = {{p.edge.u, p.edge.distance + p.edge.costToU(), p.edge.costToU()},
+                                   {p.edge.v, p.edge.distance + p.edge.costToV(), p.edge.costToV()}};
+                        p.lat = p.edge.lat;
+                        p.lng = p.edge.lon;
+                    } else if (ids[i] >= 0) {
+                        int idx = (int)ids[i];
+                        p.seeds = {{idx, CSRGraph::haversine(lat, lng, csr.lat(idx), csr.lon(idx)), 0.0}};
+                        p.lat = csr.lat(idx);
+                        p.lng = csr.lon(idx);
+                    }
+                }
+            };
+            std::vector<Snapped> sources, targets;
+            snapAll(sourceList, sources);
+            snapAll(targetList, targets);
+
+            std::vector<std::vector<SearchEndpoint>> sourceSeeds, targetSeeds;
+            for (const auto &p : sources) sourceSeeds.push_back(p.seeds);
+            for (const auto &p : targets) targetSeeds.push_back(p.seeds);
+
+            const size_t S = sources.size(), T = targets.size();
+            const int threads = std::min(defaultThreadCount(), (int)(std::max(S, T) / 4) + 1);
+            auto startTime = std::chrono::steady_clock::now();
+            std::vector<double> matrix = mode == "ch" ? ch.distanceMatrix(csr, sourceSeeds, targetSeeds, threads)
+                                                      : Algorithms::distanceMatrix(csr, sourceSeeds, targetSeeds, threads);
+            double searchMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+            // Points on the same segment can also be joined along it directly
+            if (snap == "edge") {
+                for (size_t i = 0; i < S; i++)
+                    for (size_t j = 0; j < T; j++) {
+                        const EdgeSnap &a = sources[i].edge, &b = targets[j].edge;
+                        if (!a.found() || !b.found() || !a.sameEdge(b)) continue;
+                        double bt = b.u == a.u ? b.t : 1.0 - b.t;
+                        matrix[i * T + j] = std::min(matrix[i * T + j], std::fabs(a.t - bt) * a.weight);
+                    }
+            }
+
+            // Written by hand: a wvalue per cell costs far more than the search
+            metrics::ScopedTimer serializeTimer(serializeSeconds);
+            std::string out;
+            out.reserve(S * T * 10 + (S + T) * 48 + 128);
+            char num[64];
+            auto points = [&](const char *name, const std::vector<Snapped> &pts) {
+                out += '"';
+                out += name;
+                out += "\":[";
+                for (size_t i = 0; i < pts.size(); i++) {
+                    if (i) out += ',';
+                    if (pts[i].seeds.empty()) { out += "null"; continue; }
+                    snprintf(num, sizeof(num), "{\"lat\":%.7f,\"lng\":%.7f}", pts[i].lat, pts[i].lng);
+                    out += num;
+                }
+                out += "],";
+            };
+            out += '{';
+            points("sources", sources);
+            points("targets", targets);
+            out += "\"distances\":[";
+            for (size_t i = 0; i < S; i++) {
+                out += i ? ",[" : "[";
+                for (size_t j = 0; j < T; j++) {
+                    if (j) out += ',';
+                    double d = matrix[i * T + j];
+                    if (std::isinf(d)) { out += "null"; continue; }
+                    snprintf(num, sizeof(num), "%.1f", d);
+                    out += num;
+                }
+                out += ']';
+            }
+            snprintf(num, sizeof(num), "],\"search_ms\":%.3f,", searchMs);
+            out += num;
+            out += "\"mode\":\"" + mode + "\",\"snap\":\"" + snap + "\"}";
+
+            LOG_DEBUG << "Matrix served" << logging::kv("mode", mode) << logging::kv("sources", S)
+                      << logging::kv("targets", T) << logging::kv("search_ms", searchMs);
+
+            crow::response res(std::move(out));
+            res.add_header("Content-Type", "application/json");
+            return res;
+
+        } catch (const std::exception& e) {
+            LOG_ERROR << "Request failed" << logging::kv("error", std::string(e.what()));
+            return crow::response(500, "Internal server error");
+        }
+    });
+
+    CROW_ROUTE(app, "/isochrone").methods("POST"_method)([&](const crow::request &req)
+    {
+        try {
+            auto body = crow::json::load(req.body);
+            if (!body || body.t() != crow::json::type::Object || !body.has("lat") || !body.has("lng") ||
+                !isNumber(body["lat"]) || !isNumber(body["lng"]))
+                return crow::response(400, "Invalid JSON or missing lat/lng");
+            if ((body.has("speed_kmh") && !isNumber(body["speed_kmh"])) ||
+                (body.has("output") && !isString(body["output"])) || (body.has("snap") && !isString(body["snap"])) ||
+                (body.has("largest_component") && !isBool(body["largest_component"])))
+                return crow::response(400, "speed_kmh must be a number, output and snap strings, largest_component a boolean");
+
+            // Budgets in meters ("budgets"), or in seconds ("times") at a
+            // constant speed_kmh; all of them come out of one search.
+            const bool byTime = body.has("times");
+            const char *budgetKey = byTime ? "times" : "budgets";
+            if (!body.has(budgetKey) || body[budgetKey].t() != crow::json::type::List || body[budgetKey].size() == 0)
+                return crow::response(400, "Missing budgets (meters) or times (seconds) array");
+            const double speedKmh = body.has("speed_kmh") ? body["speed_kmh"].d() : 30.0;
+            if (byTime && !(speedKmh > 0))
+                return crow::response(400, "speed_kmh must be positive");
+
+            const size_t MAX_BUDGETS = 16;
+            const double MAX_METERS = 200000.0;
+            if (body[budgetKey].size() > MAX_BUDGETS)
+                return crow::response(400, "Too many budgets (max " + std::to_string(MAX_BUDGETS) + ")");
+            std::vector<double> budgets;
+            for (size_t i = 0; i < body[budgetKey].size(); i++) {
+                if (!isNumber(body[budgetKey][i]))
+                    return crow::response(400, "Budgets must be numbers");
+                double b = body[budgetKey][i].d();
+                double meters = byTime ? b * speedKmh / 3.6 : b;
+                if (!(meters >= 0) || meters > MAX_METERS)
+                    return crow::response(400, "Budgets must be between 0 and " + std::to_string((int)MAX_METERS) + " m");
+                budgets.push_back(meters);
+            }
+            std::sort(budgets.begin(), budgets.end());
+
+            std::string output = body.has("output") ? std::string(body["output"].s()) : "hull";
+            if (output != "hull" && output != "nodes")
+                return crow::response(400, "Unknown output, expected hull or nodes");
+            std::string snap = body.has("snap") ? std::string(body["snap"].s()) : (edgeIndex.empty() ? "node" : "edge");
+            if (snap != "edge" && snap != "node")
+                return crow::response(400, "Unknown snap, expected edge or node");
+            if (snap == "edge" && edgeIndex.empty())
+                return crow::response(400, "Edge index not built");
+            bool largestOnly = snapLargestOnly;
+            if (body.has("largest_component")) largestOnly = body["largest_component"].b();
+
+            // The budget is spent along the road from the snapped point, not
+            // on the walk from the query to the road
+            const double lat = body["lat"].d(), lng = body["lng"].d();
+            std::vector<SearchEndpoint> seeds;
+            double originLat = 0, originLng = 0;
+            {
+                metrics::ScopedTimer snapTimer(snapSeconds);
+                if (snap == "edge") {
+                    EdgeSnap e = edgeIndex.nearest(csr, lat, lng, largestOnly);
+                    if (e.found()) {
+                        seeds = {{e.u, e.costToU(), e.costToU()}, {e.v, e.costToV(), e.costToV()}};
+                        originLat = e.lat;
+                        originLng = e.lon;
+                    }
+                } else {
+                    auto ids = snapKNearest(lat, lng, 1, largestOnly ? SNAP_MAIN_COMPONENT : SNAP_HAS_NEIGHBOURS);
+                    if (!ids.empty()) {
+                        int idx = (int)ids[0];
+                        seeds = {{idx, 0.0, 0.0}};
+                        originLat = csr.lat(idx);
+                        originLng = csr.lon(idx);
+                    }
+                }
+            }
+            if (seeds.empty())
+                return crow::response(404, "No road near the point");
+
+            // Per-thread result buffer; with the thread's SearchContext a
+            // large budget costs no allocation once both have grown
+            thread_local std::vector<std::pair<int, double>> reached;
+            SearchStats stats;
+            {
+                metrics::ScopedTimer searchTimer(searchSeconds);
+                Algorithms::withinDistance(csr, seeds, budgets.back(), SearchContext::local(), reached, &stats);
+            }
+            settledNodes.observe((double)stats.settled);
+
+            // Nodes come out in distance order, so each budget's set is a
+            // prefix of the list
+            metrics::ScopedTimer serializeTimer(serializeSeconds);
+            std::string out;
+            char num[96];
+            snprintf(num, sizeof(num), "{\"origin\":{\"lat\":%.7f,\"lng\":%.7f},\"isochrones\":[", originLat, originLng);
+            out += num;
+            std::vector<PathPoint> points{{originLat, originLng}};
+            size_t end = 0;
+            for (size_t b = 0; b < budgets.size(); b++) {
+                const size_t start = end;
+                while (end < reached.size() && reached[end].second <= budgets[b]) end++;
+                if (b) out += ',';
+                snprintf(num, sizeof(num), "{\"budget_m\":%.1f,", budgets[b]);
+                out += num;
+                if (byTime) {
+                    snprintf(num, sizeof(num), "\"seconds\":%.1f,", budgets[b] * 3.6 / speedKmh);
+                    out += num;
+                }
+                snprintf(num, sizeof(num), "\"nodes\":%zu", end);
+                out += num;
+                if (output == "hull") {
+                    // The previous budget's hull stands in for its nodes
+                    for (size_t i = start; i < end; i++) {
+                        int u = reached[i].first;
+                        points.push_back({csr.lat(u), csr.lon(u)});
+                    }
+                    out += ",\"hull\":[";
+                    std::vector<PathPoint> hull = Algorithms::convexHull(std::move(points));
+                    for (size_t i = 0; i < hull.size(); i++) {
+                        snprintf(num, sizeof(num), i ? ",[%.7f,%.7f]" : "[%.7f,%.7f]", hull[i].lat, hull[i].lon);
+                        out += num;
+                    }
+                    out += ']';
+                    points = std::move(hull);
+                }
+                out += '}';
+            }
+            out += ']';
+            if (output == "nodes") {
+                out.reserve(out.size() + end * 40 + 128);
+                out += ",\"reached\":[";
+                for (size_t i = 0; i < end; i++) {
+                    int u = reached[i].first;
+                    snprintf(num, sizeof(num), i ? ",[%.7f,%.7f,%.1f]" : "[%.7f,%.7f,%.1f]",
+                             csr.lat(u), csr.lon(u), reached[i].second);
+                    out += num;
+                }
+                out += ']';
+            }
+            snprintf(num, sizeof(num), ",\"settled\":%zu,\"search_ms\":%.3f,", (size_t)stats.settled, stats.timeMs);
+            out += num;
+            out += "\"output\":\"" + output + "\",\"snap\":\"" + snap + "\"}";
+
+            LOG_DEBUG << "Isochrone served" << logging::kv("budgets", budgets.size()) << logging::kv("max_m", budgets.back())
+                      << logging::kv("settled", stats.settled) << logging::kv("search_ms", stats.timeMs);
+
+            crow::response res(std::move(out));
+            res.add_header("Content-Type", "application/json");
+            return res;
+
+        } catch (const std::exception& e) {
+            LOG_ERROR << "Request failed" << logging::kv("error", std::string(e.what()));
             return crow::response(500, "Internal server error");
         }
     });
 
-    std::cout << "Crow server started on port 5000\n";
     int port = std::stoi(std::getenv("PORT") ? std::getenv("PORT") : "5000");
-    app.port(port).multithreaded().run();    
+    LOG_INFO << "Server starting" << logging::kv("port", port);
+    app.port(port).multithreaded().run();
+    logging::flush();
 }
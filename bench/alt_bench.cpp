@@ -0,0 +1,72 @@
+// A* with the haversine heuristic vs ALT on random queries.
+//
+//   alt_bench [nodes.csv] [nodes.txt] [--landmarks K] [--queries N] [--seed S]
+//
+// Both variants must agree on every distance; the report compares the
+// settled-node counts and search times.
+#include "Algo.h"
+#include "GraphLoader.h"
+#include <random>
+#include <cstring>
+#include <chrono>
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> files = {"nodes.csv", "nodes.txt"};
+    int landmarkCount = 16, queries = 1000;
+    unsigned seed = 1;
+    for (int i = 1, f = 0; i < argc; i++) {
+        if (std::strcmp(argv[i], "--landmarks") == 0 && i + 1 < argc) landmarkCount = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--queries") == 0 && i + 1 < argc) queries = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = (unsigned)std::atoi(argv[++i]);
+        else if (f < 2) files[f++] = argv[i];
+    }
+
+    Graph g;
+    loadNodeCoordinates(g, files[0]);
+    loadGraph(files[1], g);
+    g.buildNodeIndexMapping();
+    g.releaseBuildData();
+    const CSRGraph &csr = g.get_csr();
+    if (csr.empty()) return 1;
+
+    SearchContext ctx;
+    Landmarks lm;
+    auto t0 = std::chrono::high_resolution_clock::now();
+    lm.build(csr, landmarkCount, ctx);
+    std::chrono::duration<double, std::milli> buildMs = std::chrono::high_resolution_clock::now() - t0;
+    std::cout << "Landmarks: " << lm.count() << " selected in " << buildMs.count() << " ms, "
+              << lm.memoryBytes() / (1024 * 1024) << " MB of tables\n";
+
+    // Random pairs inside the main component so every query has an answer.
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> pick(0, csr.numNodes() - 1);
+    auto randomMainNode = [&]() {
+        int v;
+        do { v = pick(rng); } while (csr.component(v) != csr.largestComponent());
+        return v;
+    };
+
+    long long settledPlain = 0, settledAlt = 0;
+    double msPlain = 0.0, msAlt = 0.0;
+    int mismatches = 0;
+    for (int q = 0; q < queries; q++) {
+        int s = randomMainNode(), t = randomMainNode();
+        PathResult plain = Algorithms::AstarMulti(csr, {{s, 0.0}}, {{t, 0.0}}, ctx);
+        PathResult alt = Algorithms::AstarALT(csr, lm, {{s, 0.0}}, {{t, 0.0}}, ctx);
+        settledPlain += plain.stats.settled;
+        settledAlt += alt.stats.settled;
+        msPlain += plain.stats.timeMs;
+        msAlt += alt.stats.timeMs;
+        if (std::fabs(plain.distance - alt.distance) > 1e-3 * std::max(1.0, plain.distance)) mismatches++;
+    }
+
+    std::cout << "Queries: " << queries << "\n";
+    std::cout << "A* (haversine): avg settled " << settledPlain / std::max(1, queries)
+              << ", avg " << msPlain / std::max(1, queries) << " ms\n";
+    std::cout << "A* (ALT):       avg settled " << settledAlt / std::max(1, queries)
+              << ", avg " << msAlt / std::max(1, queries) << " ms\n";
+    std::cout << "Settled ratio:  " << (settledAlt ? (double)settledPlain / settledAlt : 0.0) << "x fewer\n";
+    std::cout << "Distance mismatches: " << mismatches << "\n";
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,267 @@
+// Latency and work of every routing engine on reproducible query sets.
+//
+//   routing_bench [nodes.csv] [nodes.txt] [--snapshot graph.bin] [--ch graph.ch]
+//                 [--landmarks K] [--queries N] [--rank-sources S] [--seed S]
+//                 [--engines dijkstra,astar,...] [--json out.json|-]
+//
+// Two query sets are generated from the seed: "random" (N uniform pairs in
+// the largest component) and "rank" (for S random sources, the targets
+// settled 2^6, 2^7, ... nodes into a Dijkstra from that source, which
+// spreads queries evenly over short and long distances). Every engine runs
+// every query; the report gives p50/p95/p99 latency and the mean settled
+// nodes and relaxed edges per set, plus memory. All distances are checked
+// against Dijkstra. --json writes the same numbers for diffing two builds.
+#include "Algo.h"
+#include "CH.h"
+#include "GraphLoader.h"
+#include "Log.h"
+#include <fstream>
+#include <random>
+#include <cstring>
+#include <chrono>
+#include <queue>
+#include <iomanip>
+#include <functional>
+
+namespace {
+
+struct Query {
+    int source;
+    int target;
+    int rank; // log2 Dijkstra rank, 0 for the random set
+};
+
+struct QuerySet {
+    std::string name;
+    std::vector<Query> queries;
+};
+
+struct EngineResult {
+    std::string engine;
+    std::string set;
+    std::vector<double> latencyMs;
+    long long settled = 0;
+    long long relaxed = 0;
+    int mismatches = 0;
+};
+
+struct Engine {
+    std::string name;
+    std::function<PathResult(int, int, SearchContext &)> run;
+};
+
+double percentile(std::vector<double> sorted, double p)
+{
+    if (sorted.empty()) return 0.0;
+    std::sort(sorted.begin(), sorted.end());
+    size_t i = (size_t)std::ceil(p / 100.0 * sorted.size());
+    return sorted[std::min(sorted.size() - 1, i > 0 ? i - 1 : 0)];
+}
+
+// Resident and peak resident set size from /proc (0 where unavailable)
+void readRss(size_t &rssKb, size_t &peakKb)
+{
+    rssKb = peakKb = 0;
+    std::ifstream in("/proc/self/status");
+    std::string key;
+    size_t value;
+    while (in >> key) {
+        if (key == "VmRSS:" && in >> value) rssKb = value;
+        else if (key == "VmHWM:" && in >> value) peakKb = value;
+    }
+}
+
+// Nodes in the order a plain Dijkstra from source settles them
+std::vector<int> settleOrder(const CSRGraph &g, int source)
+{
+    std::vector<double> dist(g.numNodes(), std::numeric_limits<double>::infinity());
+    std::vector<char> done(g.numNodes(), 0);
+    std::priority_queue<std::pair<double, int>, std::vector<std::pair<double, int>>, std::greater<>> pq;
+    std::vector<int> order;
+    dist[source] = 0.0;
+    pq.push({0.0, source});
+    while (!pq.empty()) {
+        auto [d, u] = pq.top();
+        pq.pop();
+        if (done[u]) continue;
+        done[u] = 1;
+        order.push_back(u);
+        for (uint32_t e = g.edgeBegin(u); e < g.edgeEnd(u); e++) {
+            int v = g.target(e);
+            double nd = d + g.weight(e);
+            if (nd < dist[v]) {
+                dist[v] = nd;
+                pq.push({nd, v});
+            }
+        }
+    }
+    return order;
+}
+
+std::string jsonEscape(const std::string &s)
+{
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> files = {"nodes.csv", "nodes.txt"};
+    std::string snapshotFile, chFile = "graph.ch", jsonFile, engineList;
+    int landmarkCount = 16, queries = 1000, rankSources = 20;
+    unsigned seed = 1;
+    for (int i = 1, f = 0; i < argc; i++) {
+        if (std::strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) snapshotFile = argv[++i];
+        else if (std::strcmp(argv[i], "--ch") == 0 && i + 1 < argc) chFile = argv[++i];
+        else if (std::strcmp(argv[i], "--landmarks") == 0 && i + 1 < argc) landmarkCount = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--queries") == 0 && i + 1 < argc) queries = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--rank-sources") == 0 && i + 1 < argc) rankSources = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = (unsigned)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--engines") == 0 && i + 1 < argc) engineList = argv[++i];
+        else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) jsonFile = argv[++i];
+        else if (f < 2) files[f++] = argv[i];
+    }
+    // Human-readable output goes to stderr when the JSON goes to stdout
+    std::ostream &out = jsonFile == "-" ? std::cerr : std::cout;
+
+    //-----Graph and preprocessing-----
+    Graph g;
+    KDTree kdt;
+    if (jsonFile == "-") logging::setOutput(stderr); // loader progress
+    loadRoutingData(g, kdt, snapshotFile, files[0], files[1]);
+    const CSRGraph &csr = g.get_csr();
+    if (csr.empty()) return 1;
+
+    SearchContext ctx;
+    Landmarks lm;
+    if (landmarkCount > 0) lm.build(csr, landmarkCount, ctx);
+    ContractionHierarchy ch;
+    bool haveCh = ch.load(chFile, csr);
+    out << "Graph: " << csr.numNodes() << " nodes, " << csr.numEdges() << " directed edges\n";
+    out << "Landmarks: " << lm.count() << ", CH: " << (haveCh ? chFile : std::string("none")) << "\n";
+
+    //-----Query sets-----
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> pick(0, csr.numNodes() - 1);
+    auto randomMainNode = [&]() {
+        int v;
+        do { v = pick(rng); } while (csr.component(v) != csr.largestComponent());
+        return v;
+    };
+    std::vector<QuerySet> sets(2);
+    sets[0].name = "random";
+    for (int q = 0; q < queries; q++) {
+        int s = randomMainNode();
+        sets[0].queries.push_back({s, randomMainNode(), 0});
+    }
+    sets[1].name = "rank";
+    for (int i = 0; i < rankSources; i++) {
+        int s = randomMainNode();
+        std::vector<int> order = settleOrder(csr, s);
+        for (int r = 6; (size_t(1) << r) < order.size(); r++)
+            sets[1].queries.push_back({s, order[size_t(1) << r], r});
+    }
+
+    //-----Engines-----
+    std::vector<Engine> engines = {
+        {"dijkstra", [&](int s, int t, SearchContext &c) { return Algorithms::Dijkstra(g, csr.id(s), csr.id(t), c); }},
+        {"astar", [&](int s, int t, SearchContext &c) { return Algorithms::AstarMulti(csr, {{s, 0.0}}, {{t, 0.0}}, c); }},
+        {"bidijkstra", [&](int s, int t, SearchContext &c) { return Algorithms::BidirectionalDijkstraMulti(csr, {{s, 0.0}}, {{t, 0.0}}, c); }},
+        {"biastar", [&](int s, int t, SearchContext &c) { return Algorithms::BidirectionalAstarMulti(csr, {{s, 0.0}}, {{t, 0.0}}, c); }},
+    };
+    if (lm.count() > 0)
+        engines.push_back({"alt", [&](int s, int t, SearchContext &c) { return Algorithms::AstarALT(csr, lm, {{s, 0.0}}, {{t, 0.0}}, c); }});
+    if (haveCh)
+        engines.push_back({"ch", [&](int s, int t, SearchContext &c) { return ch.query(csr, {{s, 0.0}}, {{t, 0.0}}, c); }});
+    if (!engineList.empty()) {
+        std::string wanted = "," + engineList + ",";
+        engines.erase(std::remove_if(engines.begin(), engines.end(), [&](const Engine &e) {
+            return wanted.find("," + e.name + ",") == std::string::npos;
+        }), engines.end());
+    }
+
+    //-----Runs-----
+    // Reference distances come from Dijkstra, run once per query up front.
+    std::vector<std::vector<double>> reference(sets.size());
+    for (size_t si = 0; si < sets.size(); si++)
+        for (const Query &q : sets[si].queries)
+            reference[si].push_back(Algorithms::Dijkstra(g, csr.id(q.source), csr.id(q.target), ctx).distance);
+
+    std::vector<EngineResult> results;
+    int mismatches = 0;
+    for (const Engine &engine : engines) {
+        for (size_t si = 0; si < sets.size(); si++) {
+            EngineResult r;
+            r.engine = engine.name;
+            r.set = sets[si].name;
+            for (size_t qi = 0; qi < sets[si].queries.size(); qi++) {
+                const Query &q = sets[si].queries[qi];
+                auto t0 = std::chrono::high_resolution_clock::now();
+                PathResult res = engine.run(q.source, q.target, ctx);
+                std::chrono::duration<double, std::milli> ms = std::chrono::high_resolution_clock::now() - t0;
+                r.latencyMs.push_back(ms.count());
+                r.settled += res.stats.settled;
+                r.relaxed += res.stats.relaxed;
+                double ref = reference[si][qi];
+                if (std::fabs(res.distance - ref) > 1e-3 * std::max(1.0, ref)) r.mismatches++;
+            }
+            mismatches += r.mismatches;
+            results.push_back(std::move(r));
+        }
+    }
+
+    size_t rssKb, peakKb;
+    readRss(rssKb, peakKb);
+
+    //-----Report-----
+    out << "\n" << std::left << std::setw(12) << "engine" << std::setw(8) << "set" << std::right
+        << std::setw(8) << "queries" << std::setw(11) << "p50 ms" << std::setw(11) << "p95 ms"
+        << std::setw(11) << "p99 ms" << std::setw(12) << "settled" << std::setw(12) << "relaxed"
+        << std::setw(6) << "bad" << "\n";
+    for (const EngineResult &r : results) {
+        size_t n = std::max<size_t>(1, r.latencyMs.size());
+        out << std::left << std::setw(12) << r.engine << std::setw(8) << r.set << std::right
+            << std::setw(8) << r.latencyMs.size() << std::fixed << std::setprecision(3)
+            << std::setw(11) << percentile(r.latencyMs, 50) << std::setw(11) << percentile(r.latencyMs, 95)
+            << std::setw(11) << percentile(r.latencyMs, 99) << std::setprecision(0)
+            << std::setw(12) << (double)r.settled / n << std::setw(12) << (double)r.relaxed / n
+            << std::setw(6) << r.mismatches << "\n" << std::defaultfloat << std::setprecision(6);
+    }
+    out << "\nMemory: CSR " << csr.memoryBytes() / 1024 << " KB, landmarks " << lm.memoryBytes() / 1024
+        << " KB, CH " << ch.memoryBytes() / 1024 << " KB, RSS " << rssKb << " KB (peak " << peakKb << " KB)\n";
+    out << "Distance mismatches: " << mismatches << "\n";
+
+    if (!jsonFile.empty()) {
+        std::ofstream file;
+        if (jsonFile != "-") file.open(jsonFile);
+        std::ostream &js = jsonFile == "-" ? std::cout : file;
+        js << std::setprecision(9);
+        js << "{\n  \"nodes\": " << csr.numNodes() << ",\n  \"edges\": " << csr.numEdges()
+           << ",\n  \"seed\": " << seed << ",\n  \"landmarks\": " << lm.count()
+           << ",\n  \"memory_kb\": {\"csr\": " << csr.memoryBytes() / 1024 << ", \"landmarks\": " << lm.memoryBytes() / 1024
+           << ", \"ch\": " << ch.memoryBytes() / 1024 << ", \"rss\": " << rssKb << ", \"peak_rss\": " << peakKb << "},\n"
+           << "  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const EngineResult &r = results[i];
+            size_t n = std::max<size_t>(1, r.latencyMs.size());
+            js << "    {\"engine\": \"" << jsonEscape(r.engine) << "\", \"set\": \"" << jsonEscape(r.set)
+               << "\", \"queries\": " << r.latencyMs.size()
+               << ", \"p50_ms\": " << percentile(r.latencyMs, 50) << ", \"p95_ms\": " << percentile(r.latencyMs, 95)
+               << ", \"p99_ms\": " << percentile(r.latencyMs, 99)
+               << ", \"mean_settled\": " << (double)r.settled / n << ", \"mean_relaxed\": " << (double)r.relaxed / n
+               << ", \"mismatches\": " << r.mismatches << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        js << "  ]\n}\n";
+        if (jsonFile != "-" && !file) {
+            std::cerr << "Failed to write " << jsonFile << std::endl;
+            return 1;
+        }
+    }
+    return mismatches ? 1 : 0;
+}
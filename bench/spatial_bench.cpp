@@ -0,0 +1,132 @@
+// KD-tree vs uniform grid as the node snapping backend.
+//
+//   spatial_bench [nodes.csv] [--queries N] [--k K] [--seed S]
+//
+// Both indexes are built over the node coordinates and asked the same
+// nearest and k-nearest queries, uniformly over the bounding box and
+// jittered around real nodes (what snapping sees in practice). The
+// answers must be equally far away; the report compares build time,
+// memory and time per query.
+#include "kdtree.h"
+#include "GridIndex.h"
+#include "CSRGraph.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <random>
+#include <cstring>
+#include <chrono>
+#include <functional>
+
+namespace {
+
+double msSince(std::chrono::high_resolution_clock::time_point t)
+{
+    std::chrono::duration<double, std::milli> d = std::chrono::high_resolution_clock::now() - t;
+    return d.count();
+}
+
+std::vector<KDPoint> loadPoints(const std::string &filename)
+{
+    std::vector<KDPoint> points;
+    std::ifstream in(filename);
+    std::string line;
+    std::getline(in, line); // skip header
+    while (std::getline(in, line)) {
+        std::stringstream ss(line);
+        std::string id, lat, lon;
+        if (!std::getline(ss, id, ',') || !std::getline(ss, lat, ',') || !std::getline(ss, lon, ',')) continue;
+        KDPoint p;
+        p.id = (long long)points.size();
+        p.lat = std::stod(lat);
+        p.lon = std::stod(lon);
+        points.push_back(p);
+    }
+    return points;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string file = "nodes.csv";
+    int queries = 100000, k = 16;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--queries") == 0 && i + 1 < argc) queries = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--k") == 0 && i + 1 < argc) k = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = (unsigned)std::atoi(argv[++i]);
+        else file = argv[i];
+    }
+
+    std::vector<KDPoint> points = loadPoints(file);
+    if (points.empty()) {
+        std::cerr << "No points in " << file << "\n";
+        return 1;
+    }
+    std::cout << "Points: " << points.size() << "\n";
+
+    auto t = std::chrono::high_resolution_clock::now();
+    KDTree kdt;
+    kdt.build(points);
+    double kdBuildMs = msSince(t);
+    t = std::chrono::high_resolution_clock::now();
+    GridIndex grid;
+    grid.build(points);
+    double gridBuildMs = msSince(t);
+    std::cout << "KD-tree: built in " << kdBuildMs << " ms, " << kdt.memoryBytes() / 1024 << " KB\n";
+    std::cout << "Grid:    built in " << gridBuildMs << " ms, " << grid.memoryBytes() / 1024 << " KB, "
+              << grid.cellMeters() << " m cells\n";
+
+    // Query sets
+    double minLat = points[0].lat, maxLat = minLat, minLon = points[0].lon, maxLon = minLon;
+    for (const auto &p : points) {
+        minLat = std::min(minLat, p.lat); maxLat = std::max(maxLat, p.lat);
+        minLon = std::min(minLon, p.lon); maxLon = std::max(maxLon, p.lon);
+    }
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> uLat(minLat, maxLat), uLon(minLon, maxLon);
+    std::uniform_int_distribution<size_t> pick(0, points.size() - 1);
+    std::normal_distribution<double> jitter(0.0, 0.0005); // about 50 m
+    std::vector<std::pair<double, double>> uniform(queries), nearNodes(queries);
+    for (int i = 0; i < queries; i++) {
+        uniform[i] = {uLat(rng), uLon(rng)};
+        const KDPoint &p = points[pick(rng)];
+        nearNodes[i] = {p.lat + jitter(rng), p.lon + jitter(rng)};
+    }
+
+    // Answers are compared by distance, since ties may pick different ids
+    int mismatches = 0;
+    auto distanceTo = [&](const std::pair<double, double> &q, long long id) {
+        return id < 0 ? -1.0 : CSRGraph::haversine(q.first, q.second, points[id].lat, points[id].lon);
+    };
+    auto run = [&](const char *name, const std::vector<std::pair<double, double>> &qs, int kk) {
+        std::vector<std::vector<long long>> kdOut(qs.size()), gridOut(qs.size());
+        auto t0 = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < qs.size(); i++) kdOut[i] = kdt.kNearest(qs[i].first, qs[i].second, kk);
+        double kdNs = msSince(t0) * 1e6 / qs.size();
+        t0 = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < qs.size(); i++) gridOut[i] = grid.kNearest(qs[i].first, qs[i].second, kk);
+        double gridNs = msSince(t0) * 1e6 / qs.size();
+
+        for (size_t i = 0; i < qs.size(); i++) {
+            if (kdOut[i].size() != gridOut[i].size()) { mismatches++; continue; }
+            for (size_t j = 0; j < kdOut[i].size(); j++) {
+                if (std::fabs(distanceTo(qs[i], kdOut[i][j]) - distanceTo(qs[i], gridOut[i][j])) > 1e-6) {
+                    mismatches++;
+                    break;
+                }
+            }
+        }
+        std::cout << name << " k=" << kk << ": KD-tree " << kdNs << " ns/query, grid "
+                  << gridNs << " ns/query (" << (gridNs > 0 ? kdNs / gridNs : 0.0) << "x)\n";
+    };
+
+    std::cout << "Queries: " << queries << " per set\n";
+    run("uniform   ", uniform, 1);
+    run("near nodes", nearNodes, 1);
+    run("uniform   ", uniform, k);
+    run("near nodes", nearNodes, k);
+    std::cout << "Mismatches: " << mismatches << "\n";
+    return mismatches ? 1 : 0;
+}
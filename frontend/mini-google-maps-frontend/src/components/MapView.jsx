@@ -432,10 +432,35 @@ export default function MapView({ theme, onToggleTheme }) {
    return arr;
   };
 
+  // Whole multi-stop route in one request: the server snaps every waypoint
+  // at once and searches the legs in parallel
+  const fetchRoute = async (waypoints) => {
+    try {
+      // const apiUrl = import.meta.env.VITE_API_URL;
+      const apiUrl = 'https://mini-google-map-algorithm.onrender.com';
+      const res = await axios.post(`${apiUrl}/route`, {
+        waypoints: waypoints.map((p) => ({ lat: p.lat, lng: p.lng })),
+      });
+      if (!res.data?.path || !Array.isArray(res.data.path)) throw new Error('Invalid route response');
+      return { path: res.data.path, distance: res.data.distance_meters };
+    } catch (err) {
+      console.error('Route fetch error:', err);
+      return null;
+    }
+  };
+
   const fetchPathFrom = async (start, end) => {
     if (!start || !end) return;
     setIsFetching(true);
     const waypoints = [start, ...stops, end];
+    const route = await fetchRoute(waypoints);
+    if (route) {
+      setPath(route.path);
+      setDistanceMeters(route.distance);
+      setIsFetching(false);
+      return;
+    }
+    // Older servers without /route: one request per segment
     let merged = [];
     let total = 0;
     let distancesKnown = true;
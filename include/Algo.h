@@ -2,26 +2,115 @@
 #define ALGO_H
 
 #include"Graph.h"
+#include"PathResult.h"
+#include"SearchContext.h"
+#include"Landmarks.h"
 #include<stack>
 #include<atomic>
 #include<limits>
 #include<functional>
+#include<string>
 
 using namespace std;
 
+// One seed of a multi-source / multi-target search: a dense CSR index and
+// the extra cost (meters) of starting or ending there, e.g. the distance
+// from the clicked point to the snapped node. `offset` is the part of that
+// cost that lies on the road (a partial edge when snapping to a segment);
+// engines add it back into result.distance, the rest is only used to
+// rank the endpoints.
+struct SearchEndpoint{
+    int node;
+    double cost;
+    double offset = 0.0;
+};
+
 class Algorithms{
     public:
         //Utility
         static double heuristic(Graph & g , long long node1, long long node2);
-        static void printPath(Graph& g,unordered_map<long long, long long> &parent, long long start, long long end);
+        static double heuristic(const CSRGraph & g , int node1, int node2);
+
+        //Output sinks (opt-in, never used on the server path)
+        static void printPath(const PathResult &result);
+        static bool exportPathCSV(const PathResult &result, const string &filename = "path_cordinates.csv");
  
-        //Algorithms
-        static double Dijkstra(Graph & g , long long start, long long end);
-        static double Astar(Graph & g , long long start, long long end);
+        //Algorithms (the overloads without a context use the calling thread's one)
+        static PathResult Dijkstra(Graph & g , long long start, long long end);
+        static PathResult Dijkstra(Graph & g , long long start, long long end, SearchContext &ctx);
+        static PathResult Astar(Graph & g , long long start, long long end);
+        static PathResult Astar(Graph & g , long long start, long long end, SearchContext &ctx);
+
+        // One A* from all sources to the cheapest target, minimising
+        // source.cost + path + target.cost. result.distance is the network
+        // part plus the chosen endpoints' offsets; the chosen endpoints are
+        // result.nodes.front()/back().
+        static PathResult AstarMulti(const CSRGraph & g, const vector<SearchEndpoint> &sources,
+                                     const vector<SearchEndpoint> &targets, SearchContext &ctx);
+
+        // Offset of the cheapest endpoint seeded at node (0 if none).
+        static double endpointOffset(const vector<SearchEndpoint> &endpoints, int node);
+
+        // Bidirectional variants (the graph is undirected, so the backward
+        // search walks the same CSR). Bidirectional A* uses the average
+        // potential (h_target - h_source) / 2 so both sides stay consistent.
+        static PathResult BidirectionalDijkstra(Graph & g , long long start, long long end);
+        static PathResult BidirectionalDijkstra(Graph & g , long long start, long long end, SearchContext &ctx);
+        static PathResult BidirectionalAstar(Graph & g , long long start, long long end);
+        static PathResult BidirectionalAstar(Graph & g , long long start, long long end, SearchContext &ctx);
+        static PathResult BidirectionalDijkstraMulti(const CSRGraph & g, const vector<SearchEndpoint> &sources,
+                                                     const vector<SearchEndpoint> &targets, SearchContext &ctx);
+        static PathResult BidirectionalAstarMulti(const CSRGraph & g, const vector<SearchEndpoint> &sources,
+                                                  const vector<SearchEndpoint> &targets, SearchContext &ctx);
+
+        // AstarMulti with the ALT heuristic: the max of the landmark bounds
+        // and the straight-line bound.
+        static PathResult AstarALT(const CSRGraph & g, const Landmarks &lm, const vector<SearchEndpoint> &sources,
+                                   const vector<SearchEndpoint> &targets, SearchContext &ctx);
+
+        // One Dijkstra from a source's seeds to every target's seeds.
+        // Entry j is the network distance to target j, seed offsets
+        // included (the straight-line part of cost is ignored), or infinity
+        // when no seed of j shares a component with the source. The search
+        // stops once every reachable target seed is settled.
+        static vector<double> oneToMany(const CSRGraph & g, const vector<SearchEndpoint> &source,
+                                        const vector<vector<SearchEndpoint>> &targets, SearchContext &ctx,
+                                        SearchStats *stats = nullptr);
+
+        // Row-major sources x targets matrix of oneToMany, with the sources
+        // split across up to `threads` threads of the shared WorkerPool.
+        static vector<double> distanceMatrix(const CSRGraph & g, const vector<vector<SearchEndpoint>> &sources,
+                                             const vector<vector<SearchEndpoint>> &targets, int threads = 1);
+
+        // Bounded Dijkstra: every node whose network distance from the seeds
+        // (offsets as start distances) is at most maxDistance, in settle
+        // order with its distance. out is cleared, not reallocated, so a
+        // per-thread buffer stops allocating once it has grown.
+        static void withinDistance(const CSRGraph & g, const vector<SearchEndpoint> &sources, double maxDistance,
+                                   SearchContext &ctx, vector<pair<int, double>> &out, SearchStats *stats = nullptr);
+
+        // Convex hull (counter-clockwise, no repeated first point) of points
+        // treated as planar lon/lat, which is fine at city scale.
+        static vector<PathPoint> convexHull(vector<PathPoint> points);
 
         //Efficiency
         static void efficiency(Graph & g, long long start, long long end);
+
+        // Keeps only the seeds whose component is shared with the other side.
+        // Returns false when no source can reach any target.
+        static bool filterReachable(const CSRGraph & g, const vector<SearchEndpoint> &sources,
+                                    const vector<SearchEndpoint> &targets,
+                                    vector<SearchEndpoint> &outSources, vector<SearchEndpoint> &outTargets);
+
+    private:
+        template<typename Heuristic>
+        static PathResult astarSearch(const CSRGraph & g, const vector<SearchEndpoint> &start,
+                                      vector<SearchEndpoint> &goal, SearchContext &ctx, Heuristic h);
+        template<typename Potential>
+        static PathResult bidirectionalSearch(const CSRGraph & g, const vector<SearchEndpoint> &start,
+                                              const vector<SearchEndpoint> &goal, SearchContext &ctx, Potential pf);
+        static void buildPath(const CSRGraph &g, const SearchSpace &S, int end, PathResult &result);
 };
 
 
-#endif
\ No newline at end of file
+#endif
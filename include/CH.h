@@ -0,0 +1,67 @@
+#ifndef CH_H
+#define CH_H
+
+#include "Algo.h"
+#include <string>
+
+using namespace std;
+
+// Contraction Hierarchy over a CSRGraph.
+//
+// build() contracts the nodes one by one in order of importance and keeps,
+// for every node, only its edges to higher-ranked nodes (original edges
+// and shortcuts). The road graph is undirected, so that single upward
+// graph serves both the forward and the backward search of a query.
+// Shortcuts remember the contracted middle node for path unpacking.
+class ContractionHierarchy
+{
+public:
+    // Offline preprocessing; verbose prints progress to stdout.
+    void build(const CSRGraph &g, bool verbose = false);
+
+    // Binary hierarchy file. load() rejects files built for another graph.
+    bool save(const string &filename) const;
+    bool load(const string &filename, const CSRGraph &g);
+
+    bool empty() const { return rank.empty(); }
+    int numNodes() const { return (int)rank.size(); }
+    size_t numUpEdges() const { return upTargets.size(); }
+    size_t numShortcuts() const;
+    size_t memoryBytes() const {
+        return (rank.capacity() + upOffsets.capacity()) * sizeof(uint32_t) + upTargets.capacity() * sizeof(int32_t)
+             + upWeights.capacity() * sizeof(float) + upMiddle.capacity() * sizeof(int32_t);
+    }
+
+    // Bidirectional upward Dijkstra between sets of seeds, same contract
+    // as Algorithms::AstarMulti: minimises source.cost + path + target.cost
+    // and reports the network distance of the unpacked path.
+    PathResult query(const CSRGraph &g, const vector<SearchEndpoint> &sources,
+                     const vector<SearchEndpoint> &targets, SearchContext &ctx) const;
+
+    // Many-to-many distances with buckets: one upward search per target
+    // records (target, distance) at every node it settles, then one upward
+    // search per source scans the buckets of the nodes it settles. Same
+    // semantics and row-major layout as Algorithms::distanceMatrix; both
+    // phases are split across up to `threads` threads of the shared WorkerPool.
+    vector<double> distanceMatrix(const CSRGraph &g, const vector<vector<SearchEndpoint>> &sources,
+                                  const vector<vector<SearchEndpoint>> &targets, int threads = 1) const;
+
+private:
+    vector<uint32_t> rank;      // contraction position of each node
+    vector<uint32_t> upOffsets; // size N+1
+    vector<int32_t> upTargets;  // higher-ranked endpoint
+    vector<float> upWeights;
+    vector<int32_t> upMiddle;   // -1 for an original edge
+    uint64_t graphFingerprint = 0;
+
+    // Index of the upward edge between low and high (rank[low] < rank[high]).
+    uint32_t findUpEdge(int low, int high) const;
+    // Every node settled by an upward search from seeds (offsets as start
+    // distances), with its distance.
+    void upwardSearch(const CSRGraph &g, const vector<SearchEndpoint> &seeds, SearchContext &ctx,
+                      vector<pair<int, double>> &out) const;
+    // Appends the original-graph nodes after u up to and including v.
+    void unpack(int u, int v, vector<int> &out) const;
+};
+
+#endif
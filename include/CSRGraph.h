@@ -0,0 +1,135 @@
+#ifndef CSRGRAPH_H
+#define CSRGRAPH_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+using namespace std;
+
+class Graph;
+
+// Raw views of every CSRGraph array. A CSRGraph either owns the memory
+// behind them (build) or borrows it, e.g. from a mapped snapshot (attach).
+struct CSRArrays
+{
+    int32_t numNodes = 0;
+    uint64_t numEdges = 0;
+    int32_t numComponents = 0;
+    int32_t largestComponent = -1;
+    uint64_t fingerprint = 0;               // see CSRGraph::fingerprint()
+
+    const uint32_t *offsets = nullptr;      // N+1
+    const int32_t *targets = nullptr;       // M
+    const float *weights = nullptr;         // M, meters
+    const double *lats = nullptr;           // N, degrees
+    const double *lons = nullptr;           // N, degrees
+    const long long *ids = nullptr;         // N, OSM node id of each index
+    const int32_t *byId = nullptr;          // N, indices sorted by OSM id (for indexOf)
+    const int32_t *components = nullptr;    // N, connected component of each node
+    const int32_t *componentSizes = nullptr; // numComponents
+};
+
+// One undirected edge between dense node indices, used to build a
+// CSRGraph without going through the hash-map Graph (OSM ingestion).
+struct CSREdge
+{
+    int32_t from;
+    int32_t to;
+    float weight;
+};
+
+// Frozen, read-only road graph in Compressed Sparse Row form.
+// Nodes are addressed by dense int32 indices (the ones assigned by
+// Graph::buildNodeIndexMapping), edges of node u live in
+// [offsets[u], offsets[u+1]) of the targets/weights arrays, and the
+// coordinates are kept as separate lat/lon arrays so the search loops
+// never touch a hash map.
+class CSRGraph
+{
+private:
+    CSRArrays a;
+
+    // Owned storage when built in memory
+    vector<uint32_t> offsets;
+    vector<int32_t> targets;
+    vector<float> weights;
+    vector<double> lats;
+    vector<double> lons;
+    vector<long long> ids;
+    vector<int32_t> byId;
+    vector<int32_t> components;
+    vector<int32_t> componentSizes;
+
+    // Keeps borrowed memory (a file mapping) alive
+    shared_ptr<const void> owner;
+
+    void buildComponents();
+    void finishBuild(int threads = 1);
+    void bindOwned();
+
+public:
+    CSRGraph() = default;
+    CSRGraph(const CSRGraph &other){ *this = other; }
+    CSRGraph(CSRGraph &&other) = default;   // moved vectors keep their buffers
+    CSRGraph &operator=(const CSRGraph &other);
+    CSRGraph &operator=(CSRGraph &&other) = default;
+
+    // Builds from g using g.indexToId / g.idToIndex, so
+    // g.buildNodeIndexMapping() must have run first.
+    void build(const Graph &g);
+    // Builds from per-node arrays (index order) and an undirected edge
+    // list; every edge is stored in both directions, self loops are
+    // dropped and parallel edges collapse to the cheapest one. The result
+    // does not depend on `threads`.
+    void build(vector<long long> nodeIds, vector<double> nodeLats, vector<double> nodeLons,
+               const vector<CSREdge> &edges, int threads = 1);
+    void clear();
+
+    // Borrows the arrays described by view; owner keeps them alive.
+    void attach(const CSRArrays &view, shared_ptr<const void> keepAlive);
+    const CSRArrays &arrays() const { return a; }
+
+    int numNodes() const { return a.numNodes; }
+    size_t numEdges() const { return a.numEdges; }
+    bool empty() const { return a.numNodes == 0; }
+
+    uint32_t edgeBegin(int u) const { return a.offsets[u]; }
+    uint32_t edgeEnd(int u) const { return a.offsets[u + 1]; }
+    int degree(int u) const { return (int)(a.offsets[u + 1] - a.offsets[u]); }
+    int32_t target(uint32_t e) const { return a.targets[e]; }
+    float weight(uint32_t e) const { return a.weights[e]; }
+
+    double lat(int u) const { return a.lats[u]; }
+    double lon(int u) const { return a.lons[u]; }
+    long long id(int u) const { return a.ids[u]; }
+
+    // Connected components, labelled once at build time. Two nodes are
+    // mutually reachable iff their labels match (edges are undirected).
+    int component(int u) const { return a.components[u]; }
+    int numComponents() const { return a.numComponents; }
+    // 0 for an invalid label, e.g. largestComponent() of an empty graph
+    int componentSize(int c) const { return c >= 0 && c < a.numComponents ? a.componentSizes[c] : 0; }
+    int largestComponent() const { return a.largestComponent; }
+    bool connected(int x, int y) const { return a.components[x] == a.components[y]; }
+
+    // Dense index of an OSM node id, or -1 if the node is not in the graph.
+    int indexOf(long long osmId) const;
+
+    // Great-circle distance in meters between two indexed nodes.
+    double haversine(int a, int b) const;
+    static double haversine(double lat1, double lon1, double lat2, double lon2);
+
+    // FNV-1a hash of ids, topology and edge lengths; files derived from
+    // this graph (e.g. a contraction hierarchy) store it to detect a stale
+    // index order or changed weights. Computed once by build(); attach()
+    // takes it from the view, so a snapshot passes its verified header value.
+    uint64_t fingerprint() const { return a.fingerprint; }
+    // Rehashes the arrays, O(N + M); for checking an attached view.
+    uint64_t computeFingerprint() const;
+
+    size_t memoryBytes() const;
+};
+
+#endif
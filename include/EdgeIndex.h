@@ -0,0 +1,63 @@
+#ifndef EDGEINDEX_H
+#define EDGEINDEX_H
+
+#include "CSRGraph.h"
+#include <vector>
+#include <limits>
+
+using namespace std;
+
+// Closest point on the closest road segment to a query coordinate.
+struct EdgeSnap
+{
+    int u = -1;             // segment endpoints (dense CSR indices)
+    int v = -1;
+    double t = 0.0;         // position along u -> v, 0 at u and 1 at v
+    double lat = 0.0;       // the point on the segment
+    double lon = 0.0;
+    double distance = numeric_limits<double>::infinity(); // meters from the query
+    double weight = 0.0;    // weight of the whole edge
+
+    bool found() const { return u >= 0; }
+    // Along-road cost from the snapped point to either end of the edge
+    double costToU() const { return t * weight; }
+    double costToV() const { return (1.0 - t) * weight; }
+    bool sameEdge(const EdgeSnap &o) const { return (u == o.u && v == o.v) || (u == o.v && v == o.u); }
+};
+
+// Uniform grid over the bounding boxes of every road segment, in a local
+// equirectangular projection (meters). Each undirected edge is stored
+// once and registered in every cell its box touches; a query scans rings
+// of cells outward from the query's cell until the ring is farther away
+// than the best segment found.
+class EdgeIndex
+{
+public:
+    void build(const CSRGraph &g);
+    void clear();
+    bool empty() const { return edgeU.empty(); }
+    size_t numEdges() const { return edgeU.size(); }
+    size_t memoryBytes() const;
+
+    // mainComponentOnly restricts the answer to the largest component.
+    EdgeSnap nearest(const CSRGraph &g, double lat, double lon, bool mainComponentOnly = false) const;
+
+private:
+    vector<int32_t> edgeU;
+    vector<int32_t> edgeV;
+    vector<float> edgeWeight;
+    vector<uint8_t> edgeMain;   // 1 if the edge is in the largest component
+    vector<double> ax, ay, bx, by; // projected segment ends
+
+    vector<uint32_t> cellStart; // nx*ny + 1
+    vector<uint32_t> cellEdges;
+    double minX = 0, minY = 0, cellSize = 1;
+    int nx = 0, ny = 0;
+    double refCos = 1.0;
+
+    void project(double lat, double lon, double &x, double &y) const;
+    int cellX(double x) const;
+    int cellY(double y) const;
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define GRAPH_H
 
 #include "Node.h"
+#include "CSRGraph.h"
 
 using namespace std;
 
@@ -10,6 +11,7 @@ class Graph
 private:
     unordered_map<long long, Node> nodes;
     unordered_map<long long, vector<pair<long long, double>>> adjList;
+    CSRGraph csr;
 
 public:
     unordered_map<long long, int> idToIndex;
@@ -18,7 +20,14 @@ public:
     void addNode(long long id, double lat, double lon);
     void adEdge(long long from, long long to, double distance);
     void adEdge(long long from, long long to);
+    // Assigns dense indices to every node with edges and freezes the
+    // adjacency into the CSR form used by the search algorithms.
     void buildNodeIndexMapping();
+    // Frees the hash-map adjacency and node table once the CSR is built.
+    // After this only get_csr() is valid for queries.
+    void releaseBuildData();
+    const CSRGraph &get_csr() const;
+    CSRGraph &get_csr();
     // Getters
     const unordered_map<long long, vector<pair<long long, double>>> &get_adjList() const;
     unordered_map<long long, vector<pair<long long, double>>> &get_adjList();
@@ -0,0 +1,37 @@
+#ifndef GRAPHLOADER_H
+#define GRAPHLOADER_H
+
+#include "Graph.h"
+#include "kdtree.h"
+#include "GridIndex.h"
+#include <string>
+
+// Text loaders for the files written by the parse tool:
+// nodes.csv (id,lat,lon per line) and nodes.txt ("Node:" blocks).
+void loadNodeCoordinates(Graph &g, const std::string &filename);
+Graph loadGraph(const std::string& filename, Graph& g);
+
+// KD-tree point flags used to filter snapping candidates
+enum SnapFlag : uint8_t {
+    SNAP_HAS_NEIGHBOURS = 1,   // degree > 0
+    SNAP_MAIN_COMPONENT = 2,   // in the largest connected component
+};
+
+// KD-tree over every CSR node; point ids are dense CSR indices and the
+// SnapFlag bits are set.
+void buildKDTree(const CSRGraph &csr, KDTree &kdt);
+void setSnapFlags(const CSRGraph &csr, KDTree &kdt);
+
+// Same points and flags in a uniform grid (SPATIAL_INDEX=grid)
+void buildGridIndex(const CSRGraph &csr, GridIndex &grid);
+void setSnapFlags(const CSRGraph &csr, GridIndex &grid);
+
+// Everything the server needs to route: the frozen CSR graph and the
+// snapping KD-tree. Uses the binary snapshot when snapshotFile can be
+// mapped, otherwise parses the text files and builds both from scratch.
+// Returns false when no graph could be loaded.
+bool loadRoutingData(Graph &g, KDTree &kdt, const std::string &snapshotFile,
+                     const std::string &csvFile, const std::string &txtFile,
+                     bool verifySnapshot = false);
+
+#endif
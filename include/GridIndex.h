@@ -0,0 +1,148 @@
+#pragma once
+#include "kdtree.h"
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Uniform grid over projected points, with the same query interface as
+// KDTree so the two are interchangeable as snapping backends.
+//
+// Points are bucketed by cell with a counting sort and stored cell by cell
+// in parallel arrays (x, y, id, flags); cellStart[c] .. cellStart[c+1] is
+// the range of cell c. A query scans rings of cells outward from its own
+// cell and stops once the next ring is farther away than the k-th best
+// point found. Cells are sized for a few points each on average, so
+// lookups touch a handful of contiguous runs instead of walking a tree,
+// at the cost of more scanning where the point density is very uneven.
+//
+// The index is static: there is no insert or remove, and a changed point
+// set means another build(), which is a single linear counting sort. The
+// road graph is frozen once loaded, so in-place updates would have no
+// caller, and per-cell slack for them would break up the contiguous runs
+// the scans rely on.
+class GridIndex {
+public:
+    // pointsPerCell is the average occupancy over the bounding box.
+    void build(const std::vector<KDPoint> &points, double pointsPerCell = 4.0);
+
+    size_t size() const { return ids.size(); }
+    size_t memoryBytes() const;
+    double cellMeters() const { return cellSize; }
+
+    long long nearest(double lat, double lon) const;
+    template<typename Pred>
+    long long nearest(double lat, double lon, Pred valid) const {
+        return nearestAt(lat, lon, [&](size_t i) { return valid(ids[i]); });
+    }
+
+    std::vector<long long> kNearest(double lat, double lon, int k) const;
+    template<typename Pred>
+    std::vector<long long> kNearest(double lat, double lon, int k, Pred valid) const {
+        return kNearestAt(lat, lon, k, [&](size_t i) { return valid(ids[i]); });
+    }
+
+    // Same flag semantics as KDTree::setFlags (see SnapFlag in GraphLoader.h).
+    template<typename FlagOf>
+    void setFlags(FlagOf flagOf) {
+        flags.resize(ids.size());
+        for (size_t i = 0; i < ids.size(); i++) flags[i] = flagOf(ids[i]);
+    }
+    long long nearestFlagged(double lat, double lon, uint8_t required) const {
+        return nearestAt(lat, lon, [&](size_t i) { return (flags[i] & required) == required; });
+    }
+    std::vector<long long> kNearestFlagged(double lat, double lon, int k, uint8_t required) const {
+        return kNearestAt(lat, lon, k, [&](size_t i) { return (flags[i] & required) == required; });
+    }
+
+    std::vector<long long> nearestBatch(const std::vector<std::pair<double, double>> &queries,
+                                        uint8_t required = 0, int threads = 1) const;
+    std::vector<std::vector<long long>> kNearestBatch(const std::vector<std::pair<double, double>> &queries, int k,
+                                                      uint8_t required = 0, int threads = 1) const;
+
+private:
+    std::vector<double> xs;
+    std::vector<double> ys;
+    std::vector<long long> ids;
+    std::vector<uint8_t> flags;     // empty until setFlags()
+    std::vector<uint32_t> cellStart; // nx*ny + 1
+    double minX = 0.0, minY = 0.0, cellSize = 1.0;
+    int nx = 0, ny = 0;
+    double refCos = 1.0;
+
+    void project(double lat, double lon, double &x, double &y) const;
+    int cellX(double x) const { return std::max(0, std::min(nx - 1, (int)std::floor((x - minX) / cellSize))); }
+    int cellY(double y) const { return std::max(0, std::min(ny - 1, (int)std::floor((y - minY) / cellSize))); }
+
+    template<typename Valid>
+    void search(double qx, double qy, int k, const Valid &valid,
+                std::vector<std::pair<double, long long>> &heap) const;
+
+    template<typename Valid>
+    long long nearestAt(double lat, double lon, const Valid &valid) const {
+        double qx, qy;
+        project(lat, lon, qx, qy);
+        std::vector<std::pair<double, long long>> heap;
+        search(qx, qy, 1, valid, heap);
+        return heap.empty() ? -1 : heap.front().second;
+    }
+
+    template<typename Valid>
+    std::vector<long long> kNearestAt(double lat, double lon, int k, const Valid &valid) const {
+        double qx, qy;
+        project(lat, lon, qx, qy);
+        std::vector<std::pair<double, long long>> heap;
+        search(qx, qy, k, valid, heap);
+
+        std::sort_heap(heap.begin(), heap.end());
+        std::vector<long long> out;
+        out.reserve(heap.size());
+        for (auto &p : heap) out.push_back(p.second);
+        return out;
+    }
+};
+
+template<typename Valid>
+void GridIndex::search(double qx, double qy, int k, const Valid &valid,
+                       std::vector<std::pair<double, long long>> &heap) const {
+    heap.clear();
+    if (ids.empty() || k <= 0) return;
+
+    auto worst = [&]() {
+        return (int)heap.size() < k ? std::numeric_limits<double>::infinity() : heap.front().first;
+    };
+    auto scanCell = [&](int x, int y) {
+        if (x < 0 || y < 0 || x >= nx || y >= ny) return;
+        size_t c = (size_t)y * nx + x;
+        for (uint32_t i = cellStart[c]; i < cellStart[c + 1]; i++) {
+            double dx = xs[i] - qx, dy = ys[i] - qy;
+            double d2 = dx*dx + dy*dy;
+            if (d2 >= worst() || !valid(i)) continue;
+            if ((int)heap.size() == k) {
+                std::pop_heap(heap.begin(), heap.end());
+                heap.pop_back();
+            }
+            heap.emplace_back(d2, ids[i]);
+            std::push_heap(heap.begin(), heap.end());
+        }
+    };
+
+    // Ring r holds the cells at Chebyshev distance r from the query's
+    // cell; none of them is closer than (r - 1) cells to the query, even
+    // when the query lies outside the grid and was clamped onto its edge.
+    const int cx = cellX(qx), cy = cellY(qy);
+    const int maxRing = std::max(nx, ny);
+    for (int r = 0; r <= maxRing; r++) {
+        double reach = (r - 1) * cellSize;
+        if (r > 0 && reach > 0 && reach * reach >= worst()) break;
+        for (int y = cy - r; y <= cy + r; y++) {
+            if (y == cy - r || y == cy + r) {
+                for (int x = cx - r; x <= cx + r; x++) scanCell(x, y);
+            } else {
+                scanCell(cx - r, y);
+                if (r > 0) scanCell(cx + r, y);
+            }
+        }
+    }
+}
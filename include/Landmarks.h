@@ -0,0 +1,43 @@
+#ifndef LANDMARKS_H
+#define LANDMARKS_H
+
+#include "CSRGraph.h"
+#include "SearchContext.h"
+#include <vector>
+#include <limits>
+
+using namespace std;
+
+// Landmark distance tables for the ALT heuristic (A*, Landmarks,
+// Triangle inequality). For a landmark L and any nodes v, t:
+//     d(v,t) >= |d(L,t) - d(L,v)|
+// which is a much tighter lower bound than the straight-line distance
+// on a road network. Tables are node-major floats, so one heuristic
+// evaluation reads a single contiguous run of count() values.
+class Landmarks
+{
+public:
+    // Picks `count` landmarks by farthest selection inside the largest
+    // component and computes their full distance tables (one Dijkstra each).
+    void build(const CSRGraph &g, int count, SearchContext &ctx);
+    void clear();
+
+    bool empty() const { return landmarks.empty(); }
+    int count() const { return (int)landmarks.size(); }
+    int landmark(int i) const { return landmarks[i]; }
+
+    // Distance from landmark i to v; infinity if v is in another component.
+    float distance(int v, int i) const { return table[(size_t)v * landmarks.size() + i]; }
+    const float *row(int v) const { return &table[(size_t)v * landmarks.size()]; }
+
+    // Lower bound on the network distance between a and b.
+    double lowerBound(int a, int b) const;
+
+    size_t memoryBytes() const { return table.capacity() * sizeof(float) + landmarks.capacity() * sizeof(int32_t); }
+
+private:
+    vector<int32_t> landmarks;
+    vector<float> table; // N x count()
+};
+
+#endif
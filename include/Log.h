@@ -0,0 +1,100 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <atomic>
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+// Leveled, asynchronous logger.
+//
+// A log line is formatted on the calling thread into a string and pushed
+// onto a bounded lock-free multi-producer ring; one background thread
+// drains the ring, adds the timestamp and writes batches to stdout. The
+// caller never takes a lock or waits for I/O, and when the ring is full
+// the line is dropped (and counted) instead of blocking a request.
+//
+// Lines below the current level cost one relaxed load:
+//
+//   LOG_INFO << "route served" << logging::kv("mode", mode) << logging::kv("ms", ms);
+//
+// prints in logfmt, e.g.
+//
+//   2026-10-17T18:56:44.123Z level=info thread=3 msg="route served" mode=ch ms=0.41
+namespace logging {
+
+enum class Level { Debug = 0, Info, Warning, Error };
+
+extern atomic<int> currentLevel;
+
+inline bool enabled(Level level) {
+    return (int)level >= currentLevel.load(memory_order_relaxed);
+}
+void setLevel(Level level);
+// "debug", "info", "warning" or "error"; returns false for anything else.
+bool parseLevel(const string &name, Level &out);
+// Where the writer thread sends lines, stdout by default; tools that print
+// their results on stdout move the log to stderr.
+void setOutput(FILE *out);
+
+// Key/value field appended after the message
+template<typename T>
+struct Field {
+    const char *key;
+    const T &value;
+};
+template<typename T>
+Field<T> kv(const char *key, const T &value) { return {key, value}; }
+
+// One log line; pushed to the ring when it goes out of scope.
+class Line
+{
+public:
+    explicit Line(Level level) : level(level) {
+        msg.precision(10);
+        fields.precision(10);
+    }
+    ~Line();
+    Line(const Line &) = delete;
+    Line &operator=(const Line &) = delete;
+
+    template<typename T>
+    Line &operator<<(const T &value) {
+        msg << value;
+        return *this;
+    }
+    template<typename T>
+    Line &operator<<(const Field<T> &f) {
+        fields << ' ' << f.key << '=' << f.value;
+        return *this;
+    }
+    Line &operator<<(const Field<string> &f);
+
+private:
+    Level level;
+    ostringstream msg;
+    ostringstream fields;
+};
+
+// Lines dropped because the ring was full
+size_t dropped();
+
+// Writes out everything queued so far (the background thread also drains
+// the ring at exit).
+void flush();
+
+}
+
+// A one-pass loop rather than an if/else, so `if (x) LOG_INFO << ...;`
+// never captures a following else; the stream arguments are only
+// evaluated when the level is enabled.
+#define LOG_AT(level) \
+    for (bool logOnce_ = logging::enabled(level); logOnce_; logOnce_ = false) logging::Line(level)
+#define LOG_DEBUG LOG_AT(logging::Level::Debug)
+#define LOG_INFO LOG_AT(logging::Level::Info)
+#define LOG_WARNING LOG_AT(logging::Level::Warning)
+#define LOG_ERROR LOG_AT(logging::Level::Error)
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Prometheus-style counters, gauges and histograms for the server.
+//
+// Every metric owns a few slots in a fixed-size array of 64-bit cells.
+// Each thread that records gets its own copy of that array (a shard), so
+// recording is a plain relaxed load and store on memory no other thread
+// writes: no locks, no contended cache lines. A scrape walks all shards
+// and sums them. A finished thread's shard keeps its counts and is reused
+// by the next thread that records, so there are never more shards than
+// threads recording at the same time.
+//
+// Metrics are meant to be long-lived objects created at startup (they
+// register their slots on construction and are never unregistered).
+namespace metrics {
+
+class Counter
+{
+public:
+    // labels is the inside of the braces, e.g. endpoint="snap"
+    Counter(const string &name, const string &help, const string &labels = "");
+    void inc(uint64_t n = 1) const;
+
+private:
+    size_t slot;
+};
+
+// Value that goes up and down (e.g. requests in flight). Each shard keeps
+// a signed delta, so the matching inc() and dec() may run on different
+// threads.
+class Gauge
+{
+public:
+    Gauge(const string &name, const string &help, const string &labels = "");
+    void inc() const { add(1); }
+    void dec() const { add(-1); }
+    void add(int64_t n) const;
+
+private:
+    size_t slot;
+};
+
+class Histogram
+{
+public:
+    // bounds are the bucket upper limits in increasing order; +Inf is implied
+    Histogram(const string &name, const string &help, vector<double> bounds, const string &labels = "");
+    void observe(double value) const;
+
+private:
+    size_t slot;     // bucket counts, then the total count, then the sum
+    vector<double> bounds;
+};
+
+// Bucket bounds for latencies in seconds (100 us .. 10 s) and for work
+// counters such as settled nodes (powers of ten up to 10^7).
+vector<double> latencyBuckets();
+vector<double> countBuckets();
+
+// Observes the seconds between construction and destruction.
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(const Histogram &h) : h(h), start(chrono::steady_clock::now()) {}
+    ~ScopedTimer() { h.observe(seconds()); }
+    double seconds() const { return chrono::duration<double>(chrono::steady_clock::now() - start).count(); }
+
+private:
+    const Histogram &h;
+    chrono::steady_clock::time_point start;
+};
+
+// All metrics in the Prometheus text exposition format (version 0.0.4).
+string render();
+
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef OSMINGEST_H
+#define OSMINGEST_H
+
+#include "CSRGraph.h"
+#include <string>
+
+using namespace std;
+
+struct IngestStats
+{
+    size_t waysSeen = 0;     // every way in the file
+    size_t roadWays = 0;     // ways with a highway tag
+    size_t nodesSeen = 0;    // every node in the file
+    size_t nodesKept = 0;    // road nodes that ended up in the graph
+    size_t edges = 0;        // undirected edges before deduplication
+    double wayPassMs = 0.0;
+    double nodePassMs = 0.0;
+    double buildMs = 0.0;
+};
+
+// Converts an OSM extract (.osm or .osm.pbf) into a CSR road graph in two
+// streaming passes: road ways first, to learn which node ids are needed,
+// then nodes, keeping coordinates only for those. Peak memory is the road
+// way refs plus the needed nodes, independent of the rest of the file.
+// Node indices follow OSM id order; nodes without any road edge are dropped.
+// Both passes, the edge lengths and the CSR merge run on `threads`
+// threads; the resulting graph is the same for any thread count.
+bool ingestOSM(const string &filename, CSRGraph &out, IngestStats *stats = nullptr,
+               string *error = nullptr, int threads = 1);
+
+#endif
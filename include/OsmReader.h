@@ -0,0 +1,64 @@
+#ifndef OSMREADER_H
+#define OSMREADER_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+using namespace std;
+
+// Streaming readers for OpenStreetMap extracts, .osm XML and .osm.pbf.
+// The file is read block by block (a PBF blob, or a fixed-size window of
+// XML), so memory use does not grow with the file size; decoded entities
+// are handed to the caller one block at a time.
+
+// Road ways of one block, flattened: way i has node refs
+// refs[offsets[i] .. offsets[i+1]).
+struct OsmWayBlock
+{
+    vector<long long> refs;
+    vector<uint32_t> offsets{0};
+    size_t waysSeen = 0; // every way in the block, roads or not
+
+    void clear(){ refs.clear(); offsets.assign(1, 0); waysSeen = 0; }
+    size_t size() const { return offsets.size() - 1; }
+};
+
+struct OsmNodeBlock
+{
+    vector<long long> ids;
+    vector<double> lats;
+    vector<double> lons;
+
+    void clear(){ ids.clear(); lats.clear(); lons.clear(); }
+    size_t size() const { return ids.size(); }
+};
+
+class OsmReader
+{
+public:
+    enum Format { XML, PBF };
+
+    // Detects the format from the file contents; false if unreadable.
+    bool open(const string &filename, string *error = nullptr);
+    Format format() const { return fmt; }
+
+    // Worker threads per pass: PBF blobs are inflated and decoded in
+    // parallel, XML is split into byte ranges at <node/<way boundaries.
+    // With more than one thread onBlock runs concurrently and must
+    // synchronise its own state; blocks arrive in no particular order.
+    void setThreads(int n){ threads = n > 0 ? n : 1; }
+
+    // Each call is one full pass over the file. Only ways carrying a
+    // highway tag are reported, the same rule the old DOM parser used.
+    bool readWays(const function<void(const OsmWayBlock &)> &onBlock, string *error = nullptr);
+    bool readNodes(const function<void(const OsmNodeBlock &)> &onBlock, string *error = nullptr);
+
+private:
+    string filename;
+    Format fmt = XML;
+    int threads = 1;
+};
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstddef>
+
+using namespace std;
+
+// Fork-join helpers. Work is split into one contiguous chunk per thread;
+// threads <= 1 runs inline on the caller. parallelChunks starts fresh
+// threads on every call and is meant for the offline build steps; work on
+// the request path goes through WorkerPool instead.
+
+inline int defaultThreadCount(){
+    unsigned n = thread::hardware_concurrency();
+    return n ? (int)n : 1;
+}
+
+// Calls fn(chunk, begin, end) for `threads` contiguous chunks of [0, n).
+// Returns the number of chunks actually used.
+template<typename Fn>
+int parallelChunks(size_t n, int threads, Fn fn){
+    int chunks = (int)max<size_t>(1, min<size_t>(threads > 0 ? threads : 1, n));
+    if (chunks == 1) {
+        fn(0, (size_t)0, n);
+        return 1;
+    }
+    vector<thread> pool;
+    pool.reserve(chunks - 1);
+    for (int c = 1; c < chunks; c++)
+        pool.emplace_back([&fn, c, n, chunks]() { fn(c, n * c / chunks, n * (c + 1) / chunks); });
+    fn(0, (size_t)0, n / chunks);
+    for (auto &t : pool) t.join();
+    return chunks;
+}
+
+// Long-lived worker threads with the same chunked interface as
+// parallelChunks. Nothing is created per call, so per-thread state such
+// as SearchContext::local() and the metrics shards is built once per
+// worker and reused by every request. The caller runs chunk 0 itself and,
+// while its other chunks are outstanding, helps with whatever is queued,
+// so concurrent and nested calls always make progress.
+class WorkerPool{
+public:
+    explicit WorkerPool(int threads){
+        for (int i = 0; i < threads; i++)
+            workers.emplace_back([this]() {
+                unique_lock<mutex> g(lock);
+                for (;;) {
+                    wake.wait(g, [this]() { return stopping || !queue.empty(); });
+                    if (queue.empty()) return;
+                    runFront(g);
+                }
+            });
+    }
+
+    ~WorkerPool(){
+        {
+            lock_guard<mutex> g(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &t : workers) t.join();
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    // Worker threads, not counting the callers that join in.
+    int size() const { return (int)workers.size(); }
+
+    // Calls fn(chunk, begin, end) for at most `threads` contiguous chunks
+    // of [0, n) (capped at size() + 1) and returns the number used.
+    template<typename Fn>
+    int run(size_t n, int threads, Fn fn){
+        int chunks = (int)max<size_t>(1, min<size_t>(min(threads > 0 ? threads : 1, size() + 1), n));
+        if (chunks == 1) {
+            fn(0, (size_t)0, n);
+            return 1;
+        }
+        int remaining = chunks - 1;
+        {
+            lock_guard<mutex> g(lock);
+            for (int c = 1; c < chunks; c++)
+                queue.push_back([this, &fn, &remaining, c, n, chunks]() {
+                    fn(c, n * c / chunks, n * (c + 1) / chunks);
+                    lock_guard<mutex> done(lock);
+                    if (--remaining == 0) finished.notify_all();
+                });
+        }
+        wake.notify_all();
+        fn(0, (size_t)0, n / chunks);
+
+        unique_lock<mutex> g(lock);
+        while (remaining > 0) {
+            if (!queue.empty()) runFront(g);
+            else finished.wait(g);
+        }
+        return chunks;
+    }
+
+    // Process-wide pool with one worker per core besides the caller,
+    // started on first use.
+    static WorkerPool &shared(){
+        static WorkerPool pool(max(defaultThreadCount() - 1, 0));
+        return pool;
+    }
+
+private:
+    mutex lock;
+    condition_variable wake;     // work queued or shutting down
+    condition_variable finished; // some run() has all its chunks done
+    deque<function<void()>> queue;
+    vector<thread> workers;
+    bool stopping = false;
+
+    // Pops and runs the oldest task with the lock released meanwhile.
+    void runFront(unique_lock<mutex> &g){
+        function<void()> task = std::move(queue.front());
+        queue.pop_front();
+        g.unlock();
+        task();
+        g.lock();
+    }
+};
+
+// Sorts each chunk in parallel, then merges neighbouring runs pairwise.
+template<typename It, typename Cmp>
+void parallelSort(It first, It last, int threads, Cmp cmp){
+    const size_t n = last - first;
+    if (threads <= 1 || n < 4096) {
+        sort(first, last, cmp);
+        return;
+    }
+    vector<size_t> bounds;
+    int chunks = parallelChunks(n, threads, [&](int, size_t b, size_t e) { sort(first + b, first + e, cmp); });
+    for (int c = 0; c <= chunks; c++) bounds.push_back(n * c / chunks);
+
+    while (bounds.size() > 2) {
+        vector<size_t> next;
+        const size_t pairs = (bounds.size() - 1) / 2;
+        parallelChunks(pairs, (int)pairs, [&](int, size_t b, size_t e) {
+            for (size_t p = b; p < e; p++)
+                inplace_merge(first + bounds[2 * p], first + bounds[2 * p + 1], first + bounds[2 * p + 2], cmp);
+        });
+        for (size_t i = 0; i < bounds.size(); i += 2) next.push_back(bounds[i]);
+        if (next.back() != bounds.back()) next.push_back(bounds.back());
+        bounds.swap(next);
+    }
+}
+
+template<typename It>
+void parallelSort(It first, It last, int threads){
+    parallelSort(first, last, threads, less<>());
+}
+
+// In-place exclusive prefix sum; v[i] becomes the sum of v[0..i). Returns the total.
+template<typename T>
+T parallelExclusiveScan(vector<T> &v, int threads){
+    vector<T> chunkSums(max(threads, 1) + 1, 0);
+    int chunks = parallelChunks(v.size(), threads, [&](int c, size_t b, size_t e) {
+        T s = 0;
+        for (size_t i = b; i < e; i++) s += v[i];
+        chunkSums[c + 1] = s;
+    });
+    for (int c = 0; c < chunks; c++) chunkSums[c + 1] += chunkSums[c];
+    parallelChunks(v.size(), chunks, [&](int c, size_t b, size_t e) {
+        T s = chunkSums[c];
+        for (size_t i = b; i < e; i++) {
+            T x = v[i];
+            v[i] = s;
+            s += x;
+        }
+    });
+    return chunkSums[chunks];
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef PATHRESULT_H
+#define PATHRESULT_H
+
+#include <vector>
+#include <limits>
+
+using namespace std;
+
+struct PathPoint{
+    double lat;
+    double lon;
+};
+
+// Work counters filled in by every search routine.
+struct SearchStats{
+    long long settled = 0;   // nodes popped from the heap and expanded
+    long long relaxed = 0;   // edges looked at
+    double timeMs = 0.0;     // wall time of the search loop
+};
+
+// Result of a shortest-path query, returned by value so concurrent
+// requests never share state. nodes/coordinates run from start to end
+// and are empty when no path exists.
+struct PathResult{
+    bool found = false;
+    double distance = numeric_limits<double>::infinity(); // meters
+    vector<long long> nodes;        // OSM node ids
+    vector<PathPoint> coordinates;
+    SearchStats stats;
+};
+
+#endif
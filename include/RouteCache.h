@@ -0,0 +1,84 @@
+#ifndef ROUTECACHE_H
+#define ROUTECACHE_H
+
+#include "Algo.h"
+#include "Metrics.h"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// Memory-bounded LRU cache of search results, keyed on the snapped seeds of
+// a request (nodes, costs and offsets of both ends) and the engine. Equal
+// keys always produce the same search result, so a hit can stand in for
+// the search; nearby but different clicks simply miss.
+//
+// The cache is split into shards by key hash, each with its own lock, LRU
+// list and share of the byte budget, so concurrent requests rarely touch
+// the same lock. Values are shared immutable PathResults: a hit only copies
+// a pointer under the lock.
+//
+// Every entry remembers the graph epoch it was computed on. invalidate()
+// (called whenever a different graph is bound) bumps the epoch and empties
+// the shards, and entries from an older epoch are never returned.
+class RouteCache
+{
+public:
+    explicit RouteCache(size_t maxBytes, int shards = 16);
+
+    bool enabled() const { return shardBudget > 0; }
+
+    static string key(const string &mode, const vector<SearchEndpoint> &sources,
+                      const vector<SearchEndpoint> &targets);
+
+    shared_ptr<const PathResult> get(const string &key);
+    // computedAt is epochNow() from before the search ran, so a result
+    // that raced with invalidate() is never served for the new graph.
+    void put(const string &key, const PathResult &result, uint64_t computedAt);
+    uint64_t epochNow() const { return epoch.load(memory_order_acquire); }
+
+    // Drops everything when fingerprint differs from the bound graph's.
+    void bindGraph(uint64_t fingerprint);
+    void invalidate();
+
+    size_t entries() const;
+    size_t bytes() const;
+
+private:
+    struct Entry
+    {
+        string key;
+        shared_ptr<const PathResult> value;
+        size_t bytes;
+        uint64_t epoch;
+    };
+    struct Shard
+    {
+        mutable mutex lock;
+        list<Entry> lru; // front = most recent
+        unordered_map<string, list<Entry>::iterator> index;
+        size_t bytes = 0;
+    };
+
+    vector<unique_ptr<Shard>> shards;
+    size_t shardBudget;
+    atomic<uint64_t> epoch{0};
+    mutex bindLock;
+    uint64_t graphFingerprint = 0;
+
+    metrics::Counter hits{"minimap_route_cache_hits_total", "Route cache lookups answered from the cache"};
+    metrics::Counter misses{"minimap_route_cache_misses_total", "Route cache lookups that ran a search"};
+    metrics::Counter evictions{"minimap_route_cache_evictions_total", "Entries evicted to stay within the memory bound"};
+    metrics::Gauge entryCount{"minimap_route_cache_entries", "Entries in the route cache"};
+    metrics::Gauge byteCount{"minimap_route_cache_bytes", "Approximate memory held by the route cache"};
+
+    Shard &shardFor(const string &key);
+    static size_t sizeOf(const string &key, const PathResult &r);
+    void eraseLocked(Shard &s, list<Entry>::iterator it);
+};
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef SEARCHCONTEXT_H
+#define SEARCHCONTEXT_H
+
+#include "CSRGraph.h"
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+// Distance/parent labels and a binary heap for one search direction.
+// Labels are generation stamped: reset() only bumps a counter, so a
+// query only pays for the nodes it actually touches, not for N.
+class SearchSpace
+{
+public:
+    struct HeapItem{
+        double key;
+        int node;
+    };
+
+    void resize(int n){
+        if ((int)state.size() == n) return;
+        state.assign(n, 0);
+        dist.assign(n, 0.0);
+        parent.assign(n, -1);
+        generation = 0;
+    }
+
+    void reset(){
+        heap.clear();
+        generation += 2;
+        if (generation == 0) { // wrapped around
+            fill(state.begin(), state.end(), 0);
+            generation = 2;
+        }
+    }
+
+    bool reached(int v) const { return state[v] >= generation; }
+    bool settled(int v) const { return state[v] == generation + 1; }
+
+    double distance(int v) const { return reached(v) ? dist[v] : numeric_limits<double>::infinity(); }
+    int parentOf(int v) const { return reached(v) ? parent[v] : -1; }
+
+    void label(int v, double d, int p){
+        state[v] = generation;
+        dist[v] = d;
+        parent[v] = p;
+    }
+    void settle(int v){ state[v] = generation + 1; }
+
+    // Min-heap keyed on key; duplicates allowed, stale entries are skipped
+    // by the caller via settled().
+    bool heapEmpty() const { return heap.empty(); }
+    size_t heapSize() const { return heap.size(); }
+    const HeapItem &heapTop() const { return heap.front(); }
+    void push(double key, int v){
+        heap.push_back({key, v});
+        push_heap(heap.begin(), heap.end(), heapCompare);
+    }
+    HeapItem pop(){
+        pop_heap(heap.begin(), heap.end(), heapCompare);
+        HeapItem top = heap.back();
+        heap.pop_back();
+        return top;
+    }
+
+    size_t memoryBytes() const{
+        return state.capacity() * sizeof(uint32_t) + dist.capacity() * sizeof(double)
+             + parent.capacity() * sizeof(int32_t) + heap.capacity() * sizeof(HeapItem);
+    }
+
+private:
+    // state[v] == generation     -> labelled this query
+    // state[v] == generation + 1 -> settled this query
+    vector<uint32_t> state;
+    vector<double> dist;
+    vector<int32_t> parent;
+    vector<HeapItem> heap;
+    uint32_t generation = 0;
+
+    static bool heapCompare(const HeapItem &a, const HeapItem &b){ return a.key > b.key; }
+};
+
+// Reusable scratch buffers for the routines in Algorithms. A context is
+// not thread safe; each worker thread uses its own (see local()).
+class SearchContext
+{
+public:
+    SearchSpace forward;
+    SearchSpace backward;   // only sized by bidirectional searches
+
+    // Sizes the buffers for g (allocates only when N changes) and starts
+    // a new query in O(1).
+    void prepare(const CSRGraph &g){
+        forward.resize(g.numNodes());
+        forward.reset();
+    }
+
+    void prepareBidirectional(const CSRGraph &g){
+        prepare(g);
+        backward.resize(g.numNodes());
+        backward.reset();
+    }
+
+    // The calling thread's own context, created on first use.
+    static SearchContext &local(){
+        static thread_local SearchContext ctx;
+        return ctx;
+    }
+};
+
+#endif
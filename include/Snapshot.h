@@ -0,0 +1,35 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "CSRGraph.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Versioned binary graph snapshot (graph.bin).
+//
+// Layout: a fixed 256-byte header (magic, version, counts, CSR fingerprint,
+// payload checksum and a section table) followed by 64-byte aligned
+// sections holding the CSRGraph arrays and the KD-tree build order, in
+// native little-endian form. load() maps the file read-only and points
+// the CSRGraph straight at the sections, so startup does no parsing and
+// several server processes share the same page-cache pages.
+namespace snapshot {
+
+// 2: KD order is the flat bucketed layout
+const uint32_t VERSION = 2;
+
+// Writes filename.tmp, syncs it and renames it over filename, so servers
+// that still map the old file keep a consistent view of it.
+bool write(const string &filename, const CSRGraph &g, const vector<int32_t> &kdOrder, string *error = nullptr);
+
+// Attaches g to the mapped file and copies out the KD-tree order (dense
+// indices). The stored CSR fingerprint must match the attached graph;
+// verifyChecksum also hashes the whole payload before accepting it.
+bool load(const string &filename, CSRGraph &g, vector<int32_t> &kdOrder,
+          bool verifyChecksum = false, string *error = nullptr);
+
+}
+
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+#include "Parallel.h"
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+// Batch nearest-neighbour driver shared by the point indexes (KDTree,
+// GridIndex). Queries are visited in Hilbert-curve order of their
+// position so consecutive ones touch the same part of the index, and the
+// ordered list is split across the shared WorkerPool. Results are in
+// input order.
+
+// Position of (x, y) on a Hilbert curve over a 2^16 x 2^16 grid.
+inline uint32_t hilbertIndex(uint32_t x, uint32_t y) {
+    uint32_t d = 0;
+    for (uint32_t s = 1u << 15; s > 0; s >>= 1) {
+        uint32_t rx = (x & s) ? 1 : 0;
+        uint32_t ry = (y & s) ? 1 : 0;
+        d += s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+// query(lat, lon) -> std::vector<long long> runs one k-nearest lookup.
+template<typename Query>
+std::vector<std::vector<long long>> batchQuery(const std::vector<std::pair<double, double>> &queries,
+                                               int threads, Query query) {
+    const size_t n = queries.size();
+    std::vector<std::vector<long long>> out(n);
+    if (n == 0) return out;
+
+    // Hilbert keys over the bounding box of the queries
+    double minLat = queries[0].first, maxLat = minLat, minLon = queries[0].second, maxLon = minLon;
+    for (const auto &q : queries) {
+        minLat = std::min(minLat, q.first);
+        maxLat = std::max(maxLat, q.first);
+        minLon = std::min(minLon, q.second);
+        maxLon = std::max(maxLon, q.second);
+    }
+    auto cell = [](double v, double lo, double hi) {
+        return hi > lo ? (uint32_t)std::min(65535.0, (v - lo) / (hi - lo) * 65535.0) : 0u;
+    };
+    std::vector<std::pair<uint32_t, uint32_t>> order(n);
+    for (size_t i = 0; i < n; i++)
+        order[i] = {hilbertIndex(cell(queries[i].second, minLon, maxLon), cell(queries[i].first, minLat, maxLat)), (uint32_t)i};
+    std::sort(order.begin(), order.end());
+
+    // Chunks of the curve are contiguous regions, so each thread keeps its
+    // own part of the index hot in cache. Batches arrive per request, so
+    // they run on the shared pool rather than on threads started per call.
+    WorkerPool::shared().run(n, threads, [&](int, size_t b, size_t e) {
+        for (size_t j = b; j < e; j++) {
+            const auto &q = queries[order[j].second];
+            out[order[j].second] = query(q.first, q.second);
+        }
+    });
+    return out;
+}
+
+inline std::vector<long long> firstOfEach(const std::vector<std::vector<long long>> &nearest) {
+    std::vector<long long> out(nearest.size(), -1);
+    for (size_t i = 0; i < nearest.size(); i++)
+        if (!nearest[i].empty()) out[i] = nearest[i][0];
+    return out;
+}
@@ -0,0 +1,33 @@
+#ifndef TOUR_H
+#define TOUR_H
+
+#include <vector>
+#include <cstddef>
+
+using namespace std;
+
+struct TourOptions
+{
+    bool roundTrip = false;     // return to the first stop instead of ending at the last
+    double timeLimitMs = 200.0; // local search stops here even if it could still improve
+};
+
+struct TourResult
+{
+    vector<int> order;          // stop indices in visiting order; starts at 0,
+                                // ends at n-1 (open) or 0 again (round trip)
+    double cost = 0.0;          // sum of matrix entries along `order`
+    double initialCost = 0.0;   // after nearest insertion, before local search
+    int improvements = 0;       // accepted 2-opt and Or-opt moves
+    bool timedOut = false;
+};
+
+// Orders the stops of an n x n row-major cost matrix. The first stop
+// always starts the tour and, unless roundTrip, the last one ends it;
+// everything between is reordered. Nearest insertion builds the tour,
+// then 2-opt and Or-opt (segments of 1-3 stops) improve it until no move
+// helps or the time limit is reached. Costs are assumed symmetric, which
+// holds for the undirected road graph; entries must be finite.
+TourResult solveTour(const vector<double> &matrix, size_t n, const TourOptions &options = TourOptions());
+
+#endif
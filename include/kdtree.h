@@ -3,8 +3,8 @@
 #include <functional>
 #include <limits>
 #include <algorithm>
-#include <queue>
 #include <cmath>
+#include <cstdint>
 
 struct KDPoint {
     long long id;
@@ -14,47 +14,167 @@ struct KDPoint {
     double y = 0.0;
 };
 
-struct KDNode {
-    KDPoint pt;
-    KDNode *left = nullptr;
-    KDNode *right = nullptr;
-    KDNode(const KDPoint &p) : pt(p) {}
-};
-
+// Static 2-d tree over projected points, stored without pointers.
+//
+// Points live in three parallel arrays (x, y, id) in build order. The tree
+// is implicit: node i has children 2i+1 and 2i+2, every node covers a
+// contiguous range of the arrays obtained by halving its parent's range,
+// and all leaves sit at the same depth with 16-32 points each. Internal
+// nodes only store their split coordinate; the axis alternates with depth.
+// Queries walk the tree with a small explicit stack and scan leaf buckets
+// linearly.
 class KDTree {
 public:
-    KDTree() : root(nullptr), ref_lat_deg(0.0) {}
-    ~KDTree() { deleteAll(root); }
+    static constexpr int LEAF_SIZE = 32;
 
     void build(const std::vector<KDPoint> &points);
 
+    // Point ids in the order the built tree stores them. Passing points
+    // back in this order to buildInOrder() recreates the same tree without
+    // any median selection (used by the binary graph snapshot).
+    std::vector<long long> buildOrder() const { return ids; }
+    void buildInOrder(const std::vector<KDPoint> &points);
+
+    size_t size() const { return ids.size(); }
+    size_t memoryBytes() const;
+
+    // Filtered queries take any callable bool(long long id); it is
+    // inlined into the leaf scan instead of going through std::function.
     long long nearest(double lat, double lon) const;
-    long long nearest(double lat, double lon, const std::function<bool(long long)> &valid) const;
+    template<typename Pred>
+    long long nearest(double lat, double lon, Pred valid) const {
+        return nearestAt(lat, lon, [&](size_t i) { return valid(ids[i]); });
+    }
 
     long long secondNearest(double lat, double lon) const;
 
     std::vector<long long> kNearest(double lat, double lon, int k) const;
-    std::vector<long long> kNearest(double lat, double lon, int k,
-                                    const std::function<bool(long long)> &valid) const;
+    template<typename Pred>
+    std::vector<long long> kNearest(double lat, double lon, int k, Pred valid) const {
+        return kNearestAt(lat, lon, k, [&](size_t i) { return valid(ids[i]); });
+    }
+
+    // Per-point flag byte, stored next to the coordinates in tree order so
+    // the common filters cost one byte test in the leaf scan. The meaning
+    // of the bits is up to the caller (see SnapFlag in GraphLoader.h).
+    template<typename FlagOf>
+    void setFlags(FlagOf flagOf) {
+        flags.resize(ids.size());
+        for (size_t i = 0; i < ids.size(); i++) flags[i] = flagOf(ids[i]);
+    }
+    // Only points carrying every bit of `required` qualify.
+    long long nearestFlagged(double lat, double lon, uint8_t required) const {
+        return nearestAt(lat, lon, [&](size_t i) { return (flags[i] & required) == required; });
+    }
+    std::vector<long long> kNearestFlagged(double lat, double lon, int k, uint8_t required) const {
+        return kNearestAt(lat, lon, k, [&](size_t i) { return (flags[i] & required) == required; });
+    }
+
+    // Batch snapping for many (lat, lon) queries at once (GPS traces,
+    // multi-stop routes). Queries are visited in Hilbert-curve order of
+    // their position so consecutive ones touch the same leaves, and the
+    // ordered list is split across up to `threads` threads of the shared
+    // WorkerPool. Results are in input order; required == 0 accepts every
+    // point.
+    std::vector<long long> nearestBatch(const std::vector<std::pair<double, double>> &queries,
+                                        uint8_t required = 0, int threads = 1) const;
+    std::vector<std::vector<long long>> kNearestBatch(const std::vector<std::pair<double, double>> &queries, int k,
+                                                      uint8_t required = 0, int threads = 1) const;
 
 private:
-    KDNode *root;
-    std::vector<KDPoint> pts_copy;
-    double ref_lat_deg;
+    std::vector<double> xs;
+    std::vector<double> ys;
+    std::vector<long long> ids;
+    std::vector<uint8_t> flags; // empty until setFlags()
+    std::vector<double> splits; // one per internal node
+    int depth = 0;              // depth of the leaf level
+    double ref_lat_deg = 0.0;
     static constexpr double EARTH_RADIUS_M = 6371000.0;
 
-    KDNode* buildRec(int l, int r, int depth);
-    void deleteAll(KDNode *n);
+    void layout(std::vector<KDPoint> &pts, bool presorted);
+
+    // k closest points to (qx, qy) accepted by valid(point index), as an
+    // unordered max-heap of (squared distance, id).
+    template<typename Valid>
+    void search(double qx, double qy, int k, const Valid &valid,
+                std::vector<std::pair<double, long long>> &heap) const;
+
+    template<typename Valid>
+    long long nearestAt(double lat, double lon, const Valid &valid) const {
+        double qx, qy;
+        projectLatLonToMeters(lat, lon, ref_lat_deg, qx, qy);
+        std::vector<std::pair<double, long long>> heap;
+        search(qx, qy, 1, valid, heap);
+        return heap.empty() ? -1 : heap.front().second;
+    }
+
+    template<typename Valid>
+    std::vector<long long> kNearestAt(double lat, double lon, int k, const Valid &valid) const {
+        double qx, qy;
+        projectLatLonToMeters(lat, lon, ref_lat_deg, qx, qy);
+        std::vector<std::pair<double, long long>> heap;
+        search(qx, qy, k, valid, heap);
 
-    void nearestRec(KDNode *node, double qx, double qy, int depth,
-                    long long &bestId, double &bestDist,
-                    const std::function<bool(long long)> &valid) const;
+        std::sort_heap(heap.begin(), heap.end());
+        std::vector<long long> out;
+        out.reserve(heap.size());
+        for (auto &p : heap) out.push_back(p.second);
+        return out;
+    }
+
+    void buildRec(std::vector<KDPoint> &pts, size_t node, size_t l, size_t r, int level, bool presorted);
 
     static void projectLatLonToMeters(double lat_deg, double lon_deg, double ref_lat_deg,
                                       double &out_x, double &out_y);
-    static double sqDist(double x1, double y1, double x2, double y2);
-
-    template<typename HeapType>
-    void kNearestRec(KDNode *node, double qx, double qy, int depth, int k,
-                     HeapType &heap, const std::function<bool(long long)> &valid) const;
 };
+
+template<typename Valid>
+void KDTree::search(double qx, double qy, int k, const Valid &valid,
+                    std::vector<std::pair<double, long long>> &heap) const {
+    heap.clear();
+    if (ids.empty() || k <= 0) return;
+
+    struct Frame { size_t node, l, r; int level; double bound; };
+    Frame stack[64];
+    int sp = 0;
+    stack[sp++] = {0, 0, ids.size(), 0, 0.0};
+
+    auto worst = [&]() {
+        return (int)heap.size() < k ? std::numeric_limits<double>::infinity() : heap.front().first;
+    };
+
+    while (sp > 0) {
+        Frame f = stack[--sp];
+        if (f.bound >= worst()) continue;
+
+        // Walk down to the leaf on the query's side, deferring far halves
+        // that could still hold something closer than the current k-th.
+        size_t node = f.node, l = f.l, r = f.r;
+        for (int level = f.level; level < depth; level++) {
+            size_t mid = l + (r - l) / 2;
+            double diff = (level % 2 == 0 ? qx : qy) - splits[node];
+            double farBound = std::max(f.bound, diff * diff);
+            if (diff < 0) {
+                if (farBound < worst()) stack[sp++] = {2*node + 2, mid, r, level + 1, farBound};
+                node = 2*node + 1;
+                r = mid;
+            } else {
+                if (farBound < worst()) stack[sp++] = {2*node + 1, l, mid, level + 1, farBound};
+                node = 2*node + 2;
+                l = mid;
+            }
+        }
+
+        for (size_t i = l; i < r; i++) {
+            double dx = xs[i] - qx, dy = ys[i] - qy;
+            double d2 = dx*dx + dy*dy;
+            if (d2 >= worst() || !valid(i)) continue;
+            if ((int)heap.size() == k) {
+                std::pop_heap(heap.begin(), heap.end());
+                heap.pop_back();
+            }
+            heap.emplace_back(d2, ids[i]);
+            std::push_heap(heap.begin(), heap.end());
+        }
+    }
+}
@@ -1,100 +1,221 @@
 #include"Algo.h"
+#include"Log.h"
+#include"Parallel.h"
 #include<chrono>
 #include<fstream>
+#include<iomanip>
 
 //---------------Heuristic [for A Star]--------------------------------------------
 double Algorithms::heuristic(Graph & g, long long node1, long long node2){
-    auto & nodes = g.get_nodes();
-    double lat1 = nodes[node1].get_latitude();
-    double lon1 = nodes[node1].get_longitude();
-    double lat2 = nodes[node2].get_latitude();
-    double lon2 = nodes[node2].get_longitude();
+    const CSRGraph &csr = g.get_csr();
+    int a = csr.indexOf(node1);
+    int b = csr.indexOf(node2);
+    if (a < 0 || b < 0) return 0.0;
+    return csr.haversine(a, b);
+}
 
-    return g.haversine(lat1, lat2, lon1, lon2);
+double Algorithms::heuristic(const CSRGraph & g, int node1, int node2){
+    return g.haversine(node1, node2);
 }
 
-void Algorithms::printPath(Graph& g,unordered_map<long long, long long> &parent, long long start, long long end){
-    vector<long long> path;
+void Algorithms::buildPath(const CSRGraph &g, const SearchSpace &S, int end, PathResult &result){
+    result.nodes.clear();
+    result.coordinates.clear();
 
-    for(long long at = end; at != -1; at = parent[at]){
-        path.push_back(at);
-        if(at == start) break;
+    for(int at = end; at != -1; at = S.parentOf(at)){
+        result.nodes.push_back(g.id(at));
+        result.coordinates.push_back({g.lat(at), g.lon(at)});
     }
 
-    reverse(path.begin(), path.end());
-    ofstream ot("path_cordinates.csv");
-    ot<< "lat,lon\n";
+    reverse(result.nodes.begin(), result.nodes.end());
+    reverse(result.coordinates.begin(), result.coordinates.end());
+}
 
-     for (auto node : path) {
-        cout << node << " ";
-        auto n = g.get_nodes().at(node);
-        ot << n.get_latitude() << "," << n.get_longitude() << "\n";
+void Algorithms::printPath(const PathResult &result){
+    if (!result.found) {
+        LOG_INFO << "No path found";
+        return;
     }
-    cout << endl;
 
-    ot.close();
-    cout << "Path coordinates saved to path_coords.csv\n";
+    // The node list can be thousands of ids long; only dump it when debugging
+    if (logging::enabled(logging::Level::Debug)) {
+        ostringstream nodes;
+        for (size_t i = 0; i < result.nodes.size(); i++)
+            nodes << (i ? " " : "") << result.nodes[i];
+        LOG_DEBUG << "Shortest path" << logging::kv("nodes", nodes.str());
+    }
 
-    cout<<"Shortest path: ";
-    for(auto node : path)
-        cout<<node<<" ";
-    cout<<endl;
+    LOG_INFO << "Shortest path found" << logging::kv("distance_m", result.distance)
+             << logging::kv("settled", result.stats.settled) << logging::kv("ms", result.stats.timeMs);
+}
+
+bool Algorithms::exportPathCSV(const PathResult &result, const string &filename){
+    ofstream ot(filename);
+    if (!ot.is_open()) return false;
+
+    ot << setprecision(10);
+    ot<< "lat,lon\n";
+    for (const auto &p : result.coordinates)
+        ot << p.lat << "," << p.lon << "\n";
+
+    return true;
 }
 
 //---------------A Star-----------------------------------------------
-double Algorithms::Astar(Graph & g , long long startID, long long destID) {
+PathResult Algorithms::Astar(Graph & graph , long long startID, long long destID) {
+    return Astar(graph, startID, destID, SearchContext::local());
+}
 
-    auto &adj = g.get_adjList();
-    auto &idToIndex = g.idToIndex;
-    auto &indexToId = g.indexToId;
-    auto &nodes = g.get_nodes();
+PathResult Algorithms::Astar(Graph & graph , long long startID, long long destID, SearchContext &ctx) {
 
-    if (idToIndex.find(startID) == idToIndex.end() ||
-        idToIndex.find(destID) == idToIndex.end()) 
-    {
-        return std::numeric_limits<double>::infinity();
+    const CSRGraph &g = graph.get_csr();
+
+    int start = g.indexOf(startID);
+    int dest = g.indexOf(destID);
+    if (start < 0 || dest < 0)
+        return PathResult();
+
+    return AstarMulti(g, {{start, 0.0}}, {{dest, 0.0}}, ctx);
+}
+
+bool Algorithms::filterReachable(const CSRGraph & g, const vector<SearchEndpoint> &sources,
+                                 const vector<SearchEndpoint> &targets,
+                                 vector<SearchEndpoint> &outSources, vector<SearchEndpoint> &outTargets) {
+    outSources.clear();
+    outTargets.clear();
+    for (const auto &s : sources)
+        for (const auto &t : targets)
+            if (g.connected(s.node, t.node)) { outSources.push_back(s); break; }
+    for (const auto &t : targets)
+        for (const auto &s : outSources)
+            if (g.connected(s.node, t.node)) { outTargets.push_back(t); break; }
+    return !outSources.empty() && !outTargets.empty();
+}
+
+// Heuristic to a whole target set: distance to the targets' centre minus
+// the radius of the set, plus the cheapest target cost. This stays
+// admissible and consistent, and costs a single haversine.
+struct TargetSetBound{
+    double cLat = 0.0, cLon = 0.0, radius = 0.0, minCost = numeric_limits<double>::infinity();
+
+    TargetSetBound(const CSRGraph &g, const vector<SearchEndpoint> &goal){
+        for (const auto &t : goal) {
+            cLat += g.lat(t.node);
+            cLon += g.lon(t.node);
+            minCost = min(minCost, t.cost);
+        }
+        cLat /= goal.size();
+        cLon /= goal.size();
+        for (const auto &t : goal)
+            radius = max(radius, CSRGraph::haversine(cLat, cLon, g.lat(t.node), g.lon(t.node)));
     }
 
-    int start = idToIndex[startID];
-    int dest = idToIndex[destID];
-    int N = indexToId.size();
+    // Bound without the target cost
+    double distance(const CSRGraph &g, int v) const{
+        return max(0.0, CSRGraph::haversine(g.lat(v), g.lon(v), cLat, cLon) - radius);
+    }
+};
 
-    vector<double> gCost(N, numeric_limits<double>::infinity());
-    vector<double> fCost(N, numeric_limits<double>::infinity());
-    vector<int> parent(N, -1);
+PathResult Algorithms::AstarMulti(const CSRGraph & g, const vector<SearchEndpoint> &sources,
+                                  const vector<SearchEndpoint> &targets, SearchContext &ctx) {
+    // Drop seeds that cannot reach the other side at all; if nothing is
+    // left the pair is unreachable and no search is run.
+    vector<SearchEndpoint> start, goal;
+    if (!filterReachable(g, sources, targets, start, goal))
+        return PathResult();
 
-    gCost[start] = 0;
+    TargetSetBound bound(g, goal);
+    auto h = [&](int v) { return bound.distance(g, v) + bound.minCost; };
 
-    using P = pair<double, int>;
-    priority_queue<P, vector<P>, greater<P>> pq;
+    return astarSearch(g, start, goal, ctx, h);
+}
 
-    fCost[start] = heuristic(g, startID, destID);
-    pq.push({fCost[start], start});
+PathResult Algorithms::AstarALT(const CSRGraph & g, const Landmarks &lm, const vector<SearchEndpoint> &sources,
+                                const vector<SearchEndpoint> &targets, SearchContext &ctx) {
+    vector<SearchEndpoint> start, goal;
+    if (!filterReachable(g, sources, targets, start, goal))
+        return PathResult();
+
+    TargetSetBound bound(g, goal);
+
+    // Per landmark, the range [lo, hi] of d(L, t) over the targets. For any
+    // target, |d(L,t) - d(L,v)| >= max(lo - d(L,v), d(L,v) - hi, 0), which
+    // is 1-Lipschitz in d(L,v) and so keeps the heuristic consistent.
+    const int k = lm.count();
+    vector<double> lo(k, numeric_limits<double>::infinity()), hi(k, -numeric_limits<double>::infinity());
+    for (const auto &t : goal) {
+        const float *row = lm.row(t.node);
+        for (int i = 0; i < k; i++) {
+            lo[i] = min(lo[i], (double)row[i]);
+            hi[i] = max(hi[i], (double)row[i]);
+        }
+    }
 
-    auto startTime = chrono::high_resolution_clock::now();
+    auto h = [&](int v) {
+        const float *row = lm.row(v);
+        double best = bound.distance(g, v);
+        for (int i = 0; i < k; i++) {
+            double d = row[i];
+            if (std::isinf(d) || std::isinf(hi[i])) continue; // landmark in another component
+            // float tables: back off by the rounding error so the bound stays admissible
+            double slack = 1e-6 * (d + hi[i]);
+            best = max(best, max(lo[i] - d, d - hi[i]) - slack);
+        }
+        return best + bound.minCost;
+    };
 
-    while (!pq.empty()) {
-        auto [f, u] = pq.top();
-        pq.pop();
+    return astarSearch(g, start, goal, ctx, h);
+}
 
-        if (u == dest)
-            break;
+template<typename Heuristic>
+PathResult Algorithms::astarSearch(const CSRGraph & g, const vector<SearchEndpoint> &start,
+                                   vector<SearchEndpoint> &goal, SearchContext &ctx, Heuristic h) {
+    PathResult result;
+
+    // Targets sorted by node for the membership test on settle.
+    sort(goal.begin(), goal.end(), [](const SearchEndpoint &a, const SearchEndpoint &b){ return a.node < b.node; });
 
-        long long uID = indexToId[u];
+    ctx.prepare(g);
+    SearchSpace &S = ctx.forward;
 
-        for (auto &nbr : adj.at(uID)) {
-            long long vID = nbr.first;
-            double weight = nbr.second;
+    for (const auto &s : start) {
+        if (s.cost < S.distance(s.node)) {
+            S.label(s.node, s.cost, -1);
+            S.push(s.cost + h(s.node), s.node);
+        }
+    }
 
-            int v = idToIndex[vID];
-            double tentative_g = gCost[u] + weight;
+    double best = numeric_limits<double>::infinity();
+    int bestTarget = -1;
 
-            if (tentative_g < gCost[v]) {
-                gCost[v] = tentative_g;
-                fCost[v] = tentative_g + heuristic(g, vID, destID);
-                parent[v] = u;
+    auto startTime = chrono::high_resolution_clock::now();
+
+    while (!S.heapEmpty()) {
+        if (S.heapTop().key >= best)
+            break; // nothing left can beat the best target
+        int u = S.pop().node;
+
+        if (S.settled(u))
+            continue; // stale entry
+        S.settle(u);
+
+        double gu = S.distance(u);
+        auto it = lower_bound(goal.begin(), goal.end(), u,
+                              [](const SearchEndpoint &t, int node){ return t.node < node; });
+        if (it != goal.end() && it->node == u && gu + it->cost < best) {
+            best = gu + it->cost;
+            bestTarget = u;
+        }
+        result.stats.settled++;
 
-                pq.push({fCost[v], v});
+        for (uint32_t e = g.edgeBegin(u); e < g.edgeEnd(u); e++) {
+            result.stats.relaxed++;
+            int v = g.target(e);
+            double tentative_g = gu + g.weight(e);
+
+            if (tentative_g < S.distance(v)) {
+                S.label(v, tentative_g, u);
+                S.push(tentative_g + h(v), v);
             }
         }
     }
@@ -102,73 +223,220 @@ double Algorithms::Astar(Graph & g , long long startID, long long destID) {
     auto endTime = chrono::high_resolution_clock::now();
     chrono::duration<double, milli> duration = endTime - startTime;
 
-    cout << "\n--- A* Algorithm (Optimized) ---\n";
+    result.stats.timeMs = duration.count();
+
+    if (bestTarget < 0)
+        return result;
+
+    buildPath(g, S, bestTarget, result);
+
+    // Network distance only: strip the cost the chosen source was seeded with.
+    int root = bestTarget;
+    while (S.parentOf(root) != -1) root = S.parentOf(root);
+
+    result.found = true;
+    result.distance = S.distance(bestTarget) - S.distance(root)
+                    + endpointOffset(start, root) + endpointOffset(goal, bestTarget);
+    return result;
+}
+
+double Algorithms::endpointOffset(const vector<SearchEndpoint> &endpoints, int node) {
+    const SearchEndpoint *best = nullptr;
+    for (const auto &e : endpoints)
+        if (e.node == node && (!best || e.cost < best->cost)) best = &e;
+    return best ? best->offset : 0.0;
+}
+
+
+//---------------Bidirectional----------------------------------------
+PathResult Algorithms::BidirectionalDijkstra(Graph & graph , long long startID, long long destID) {
+    return BidirectionalDijkstra(graph, startID, destID, SearchContext::local());
+}
+
+PathResult Algorithms::BidirectionalDijkstra(Graph & graph , long long startID, long long destID, SearchContext &ctx) {
+    const CSRGraph &g = graph.get_csr();
+    int start = g.indexOf(startID);
+    int dest = g.indexOf(destID);
+    if (start < 0 || dest < 0)
+        return PathResult();
+    return BidirectionalDijkstraMulti(g, {{start, 0.0}}, {{dest, 0.0}}, ctx);
+}
+
+PathResult Algorithms::BidirectionalAstar(Graph & graph , long long startID, long long destID) {
+    return BidirectionalAstar(graph, startID, destID, SearchContext::local());
+}
+
+PathResult Algorithms::BidirectionalAstar(Graph & graph , long long startID, long long destID, SearchContext &ctx) {
+    const CSRGraph &g = graph.get_csr();
+    int start = g.indexOf(startID);
+    int dest = g.indexOf(destID);
+    if (start < 0 || dest < 0)
+        return PathResult();
+    return BidirectionalAstarMulti(g, {{start, 0.0}}, {{dest, 0.0}}, ctx);
+}
+
+PathResult Algorithms::BidirectionalDijkstraMulti(const CSRGraph & g, const vector<SearchEndpoint> &sources,
+                                                  const vector<SearchEndpoint> &targets, SearchContext &ctx) {
+    vector<SearchEndpoint> start, goal;
+    if (!filterReachable(g, sources, targets, start, goal))
+        return PathResult();
 
-    if (gCost[dest] == numeric_limits<double>::infinity()) {
-        cout << "No path found\n";
-        return numeric_limits<double>::infinity();   // ✔ FIX
+    return bidirectionalSearch(g, start, goal, ctx, [](int) { return 0.0; });
+}
+
+PathResult Algorithms::BidirectionalAstarMulti(const CSRGraph & g, const vector<SearchEndpoint> &sources,
+                                               const vector<SearchEndpoint> &targets, SearchContext &ctx) {
+    vector<SearchEndpoint> start, goal;
+    if (!filterReachable(g, sources, targets, start, goal))
+        return PathResult();
+
+    TargetSetBound toTarget(g, goal);
+    TargetSetBound toSource(g, start);
+    auto pf = [&](int v) {
+        double hT = toTarget.distance(g, v) + toTarget.minCost;
+        double hS = toSource.distance(g, v) + toSource.minCost;
+        return 0.5 * (hT - hS);
+    };
+
+    return bidirectionalSearch(g, start, goal, ctx, pf);
+}
+
+// Forward keys are g_f(v) + pf(v), backward keys g_b(v) - pf(v). Since the
+// two potentials sum to zero, any meeting node v has key sum g_f + g_b, and
+// the search can stop as soon as the two heap minima add up to the best
+// meeting found.
+template<typename Potential>
+PathResult Algorithms::bidirectionalSearch(const CSRGraph & g, const vector<SearchEndpoint> &start,
+                                           const vector<SearchEndpoint> &goal, SearchContext &ctx, Potential pf) {
+    PathResult result;
+
+    ctx.prepareBidirectional(g);
+    SearchSpace &F = ctx.forward;
+    SearchSpace &B = ctx.backward;
+
+    for (const auto &s : start) {
+        if (s.cost < F.distance(s.node)) { F.label(s.node, s.cost, -1); F.push(s.cost + pf(s.node), s.node); }
+    }
+    for (const auto &t : goal) {
+        if (t.cost < B.distance(t.node)) { B.label(t.node, t.cost, -1); B.push(t.cost - pf(t.node), t.node); }
     }
 
-    // Convert parent[] indices → raw IDs
-    unordered_map<long long, long long> rawParent;
-    for (int i = 0; i < N; i++) {
-        if (parent[i] == -1) rawParent[indexToId[i]] = -1;
-        else rawParent[indexToId[i]] = indexToId[parent[i]];
+    double best = numeric_limits<double>::infinity();
+    int meet = -1;
+    for (const auto &s : start) {
+        if (B.reached(s.node) && F.distance(s.node) + B.distance(s.node) < best) {
+            best = F.distance(s.node) + B.distance(s.node);
+            meet = s.node;
+        }
     }
 
-    printPath(g, rawParent, startID, destID);
+    auto startTime = chrono::high_resolution_clock::now();
 
-    cout << "Total Distance: " << gCost[dest] << " meters\n";
-    cout << "Execution Time: " << duration.count() << " ms\n";
+    while (!F.heapEmpty() && !B.heapEmpty()) {
+        if (F.heapTop().key + B.heapTop().key >= best)
+            break;
+
+        bool forwardStep = F.heapTop().key <= B.heapTop().key;
+        SearchSpace &S = forwardStep ? F : B;
+        const SearchSpace &other = forwardStep ? B : F;
+        const double sign = forwardStep ? 1.0 : -1.0;
+
+        int u = S.pop().node;
+        if (S.settled(u))
+            continue; // stale entry
+        S.settle(u);
+        result.stats.settled++;
+
+        double gu = S.distance(u);
+        for (uint32_t e = g.edgeBegin(u); e < g.edgeEnd(u); e++) {
+            result.stats.relaxed++;
+            int v = g.target(e);
+            double tentative_g = gu + g.weight(e);
+
+            if (tentative_g < S.distance(v)) {
+                S.label(v, tentative_g, u);
+                S.push(tentative_g + sign * pf(v), v);
+
+                if (other.reached(v) && tentative_g + other.distance(v) < best) {
+                    best = tentative_g + other.distance(v);
+                    meet = v;
+                }
+            }
+        }
+    }
 
-    return gCost[dest];   // ✔ REQUIRED
+    auto endTime = chrono::high_resolution_clock::now();
+    chrono::duration<double, milli> duration = endTime - startTime;
+    result.stats.timeMs = duration.count();
+
+    if (meet < 0)
+        return result;
+
+    // Forward chain source..meet, then the backward chain meet..target.
+    int sourceRoot = meet, targetRoot = meet;
+    for (int at = meet; at != -1; at = F.parentOf(at)) {
+        result.nodes.push_back(g.id(at));
+        result.coordinates.push_back({g.lat(at), g.lon(at)});
+        sourceRoot = at;
+    }
+    reverse(result.nodes.begin(), result.nodes.end());
+    reverse(result.coordinates.begin(), result.coordinates.end());
+    for (int at = B.parentOf(meet); at != -1; at = B.parentOf(at)) {
+        result.nodes.push_back(g.id(at));
+        result.coordinates.push_back({g.lat(at), g.lon(at)});
+        targetRoot = at;
+    }
+
+    result.found = true;
+    result.distance = best - F.distance(sourceRoot) - B.distance(targetRoot)
+                    + endpointOffset(start, sourceRoot) + endpointOffset(goal, targetRoot);
+    return result;
 }
 
 
 //---------------Dijkstra---------------------------------------------
-double Algorithms::Dijkstra(Graph &g, long long startId, long long destId) {
-    auto &adj = g.get_adjList();
-    auto &idToIndex = g.idToIndex;
-    auto &indexToId = g.indexToId;
-
-    // Convert raw IDs → compact indices
-    int start = idToIndex[startId];
-    int dest  = idToIndex[destId];
+PathResult Algorithms::Dijkstra(Graph &graph, long long startId, long long destId) {
+    return Dijkstra(graph, startId, destId, SearchContext::local());
+}
 
-    int N = indexToId.size();
+PathResult Algorithms::Dijkstra(Graph &graph, long long startId, long long destId, SearchContext &ctx) {
+    const CSRGraph &g = graph.get_csr();
+    PathResult result;
 
-    // Fixed memory – vectors instead of huge unordered_maps
-    vector<double> dist(N, numeric_limits<double>::infinity());
-    vector<int> parent(N, -1);
+    // Convert raw IDs → compact indices
+    int start = g.indexOf(startId);
+    int dest  = g.indexOf(destId);
+    if (start < 0 || dest < 0 || !g.connected(start, dest))
+        return result;
 
-    dist[start] = 0;
+    // Reused per-thread buffers, reset in O(1)
+    ctx.prepare(g);
+    SearchSpace &S = ctx.forward;
 
-    using P = pair<double, int>;
-    priority_queue<P, vector<P>, greater<P>> pq;
-    pq.push({0.0, start});
+    S.label(start, 0.0, -1);
+    S.push(0.0, start);
 
     auto startTime = chrono::high_resolution_clock::now();
 
-    while (!pq.empty()) {
-        auto [currentDist, u] = pq.top();
-        pq.pop();
+    while (!S.heapEmpty()) {
+        auto [currentDist, u] = S.pop();
 
+        if (S.settled(u))
+            continue; // stale entry
+        S.settle(u);
         if (u == dest)
             break;
-
-        long long uId = indexToId[u];
+        result.stats.settled++;
 
         // Relax all neighbors
-        for (auto &nbr : adj.at(uId)) {
-            long long vId = nbr.first;
-            double weight = nbr.second;
-
-            int v = idToIndex[vId];
-
-            if (currentDist + weight < dist[v]) {
-                dist[v] = currentDist + weight;
-                parent[v] = u;
-                pq.push({dist[v], v});
+        for (uint32_t e = g.edgeBegin(u); e < g.edgeEnd(u); e++) {
+            result.stats.relaxed++;
+            int v = g.target(e);
+            double weight = g.weight(e);
+
+            if (currentDist + weight < S.distance(v)) {
+                S.label(v, currentDist + weight, u);
+                S.push(currentDist + weight, v);
             }
         }
     }
@@ -176,27 +444,163 @@ double Algorithms::Dijkstra(Graph &g, long long startId, long long destId) {
     auto endTime = chrono::high_resolution_clock::now();
     chrono::duration<double, milli> duration = endTime - startTime;
 
-    cout << "\n--- Dijkstra Algorithm (Optimized) ---\n";
+    result.stats.timeMs = duration.count();
+
+    if (!S.settled(dest))
+        return result;
+
+    result.found = true;
+    result.distance = S.distance(dest);
+    buildPath(g, S, dest, result);
+    return result;
+}
 
-    // Convert parent[] indices → raw IDs
-    unordered_map<long long, long long> rawParent;
-    for (int i = 0; i < N; i++) {
-        if (parent[i] == -1) rawParent[indexToId[i]] = -1;
-        else rawParent[indexToId[i]] = indexToId[parent[i]];
+
+
+//---------------One to many------------------------------------------
+vector<double> Algorithms::oneToMany(const CSRGraph &g, const vector<SearchEndpoint> &source,
+                                     const vector<vector<SearchEndpoint>> &targets, SearchContext &ctx,
+                                     SearchStats *stats) {
+    vector<double> out(targets.size(), numeric_limits<double>::infinity());
+    if (source.empty()) return out;
+
+    // Target seeds reachable from some source seed, sorted by node so a
+    // settled node finds its targets with one binary search.
+    struct TargetSeed { int node; int target; double offset; };
+    vector<TargetSeed> seeds;
+    for (size_t j = 0; j < targets.size(); j++)
+        for (const auto &t : targets[j])
+            for (const auto &s : source)
+                if (g.connected(s.node, t.node)) { seeds.push_back({t.node, (int)j, t.offset}); break; }
+    sort(seeds.begin(), seeds.end(), [](const TargetSeed &a, const TargetSeed &b) { return a.node < b.node; });
+    size_t pendingNodes = 0;
+    for (size_t i = 0; i < seeds.size(); i++)
+        if (i == 0 || seeds[i].node != seeds[i - 1].node) pendingNodes++;
+
+    ctx.prepare(g);
+    SearchSpace &S = ctx.forward;
+    for (const auto &s : source) {
+        if (s.offset < S.distance(s.node)) { S.label(s.node, s.offset, -1); S.push(s.offset, s.node); }
     }
 
-    // Print path using raw IDs
-    printPath(g, rawParent, startId, destId);
+    SearchStats local;
+    auto startTime = chrono::high_resolution_clock::now();
+    while (pendingNodes > 0 && !S.heapEmpty()) {
+        auto [du, u] = S.pop();
+        if (S.settled(u)) continue;
+        S.settle(u);
+        local.settled++;
+
+        auto it = lower_bound(seeds.begin(), seeds.end(), u, [](const TargetSeed &t, int node) { return t.node < node; });
+        if (it != seeds.end() && it->node == u) {
+            pendingNodes--;
+            for (; it != seeds.end() && it->node == u; ++it)
+                out[it->target] = min(out[it->target], du + it->offset);
+        }
 
-    cout << "Total Distance: " << dist[dest] << " meters\n";
-    cout << "Execution Time: " << duration.count() << " ms\n";
+        for (uint32_t e = g.edgeBegin(u); e < g.edgeEnd(u); e++) {
+            local.relaxed++;
+            int v = g.target(e);
+            double nd = du + g.weight(e);
+            if (nd < S.distance(v)) {
+                S.label(v, nd, u);
+                S.push(nd, v);
+            }
+        }
+    }
+    chrono::duration<double, milli> duration = chrono::high_resolution_clock::now() - startTime;
+    local.timeMs = duration.count();
+    if (stats) *stats = local;
+    return out;
+}
 
-    return dist[dest];
+vector<double> Algorithms::distanceMatrix(const CSRGraph &g, const vector<vector<SearchEndpoint>> &sources,
+                                          const vector<vector<SearchEndpoint>> &targets, int threads) {
+    const size_t T = targets.size();
+    vector<double> matrix(sources.size() * T, numeric_limits<double>::infinity());
+    WorkerPool::shared().run(sources.size(), threads, [&](int, size_t b, size_t e) {
+        SearchContext &ctx = SearchContext::local();
+        for (size_t i = b; i < e; i++) {
+            vector<double> row = oneToMany(g, sources[i], targets, ctx);
+            copy(row.begin(), row.end(), matrix.begin() + i * T);
+        }
+    });
+    return matrix;
 }
 
+//---------------Bounded Dijkstra---------------------------------------
+void Algorithms::withinDistance(const CSRGraph &g, const vector<SearchEndpoint> &sources, double maxDistance,
+                                SearchContext &ctx, vector<pair<int, double>> &out, SearchStats *stats) {
+    out.clear();
+    ctx.prepare(g);
+    SearchSpace &S = ctx.forward;
+    for (const auto &s : sources) {
+        if (s.offset <= maxDistance && s.offset < S.distance(s.node)) {
+            S.label(s.node, s.offset, -1);
+            S.push(s.offset, s.node);
+        }
+    }
+
+    SearchStats local;
+    auto startTime = chrono::high_resolution_clock::now();
+    while (!S.heapEmpty()) {
+        auto [du, u] = S.pop();
+        if (S.settled(u)) continue;
+        S.settle(u);
+        local.settled++;
+        out.push_back({u, du});
+
+        // Labels beyond the cutoff are never pushed, so the heap runs dry
+        // exactly at the boundary.
+        for (uint32_t e = g.edgeBegin(u); e < g.edgeEnd(u); e++) {
+            local.relaxed++;
+            int v = g.target(e);
+            double nd = du + g.weight(e);
+            if (nd <= maxDistance && nd < S.distance(v)) {
+                S.label(v, nd, u);
+                S.push(nd, v);
+            }
+        }
+    }
+    chrono::duration<double, milli> duration = chrono::high_resolution_clock::now() - startTime;
+    local.timeMs = duration.count();
+    if (stats) *stats = local;
+}
 
+vector<PathPoint> Algorithms::convexHull(vector<PathPoint> pts) {
+    // Andrew's monotone chain
+    sort(pts.begin(), pts.end(), [](const PathPoint &a, const PathPoint &b) {
+        return a.lon < b.lon || (a.lon == b.lon && a.lat < b.lat);
+    });
+    pts.erase(unique(pts.begin(), pts.end(), [](const PathPoint &a, const PathPoint &b) {
+        return a.lon == b.lon && a.lat == b.lat;
+    }), pts.end());
+    if (pts.size() < 3) return pts;
+
+    auto cross = [](const PathPoint &o, const PathPoint &a, const PathPoint &b) {
+        return (a.lon - o.lon) * (b.lat - o.lat) - (a.lat - o.lat) * (b.lon - o.lon);
+    };
+    vector<PathPoint> hull(2 * pts.size());
+    size_t k = 0;
+    for (size_t i = 0; i < pts.size(); i++) {
+        while (k >= 2 && cross(hull[k - 2], hull[k - 1], pts[i]) <= 0) k--;
+        hull[k++] = pts[i];
+    }
+    for (size_t i = pts.size() - 1, lower = k + 1; i > 0; i--) {
+        while (k >= lower && cross(hull[k - 2], hull[k - 1], pts[i - 1]) <= 0) k--;
+        hull[k++] = pts[i - 1];
+    }
+    hull.resize(k - 1);
+    return hull;
+}
 
 void Algorithms::efficiency(Graph & g, long long start, long long end){
-    Dijkstra(g, start, end);
-    Astar(g, start, end);
-}
\ No newline at end of file
+    LOG_INFO << "Dijkstra" << logging::kv("start", start) << logging::kv("end", end);
+    printPath(Dijkstra(g, start, end));
+
+    LOG_INFO << "A*" << logging::kv("start", start) << logging::kv("end", end);
+    PathResult astar = Astar(g, start, end);
+    printPath(astar);
+    if (exportPathCSV(astar))
+        LOG_INFO << "Path coordinates saved" << logging::kv("file", string("path_cordinates.csv"));
+}
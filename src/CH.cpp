@@ -0,0 +1,463 @@
+#include "CH.h"
+#include "Parallel.h"
+#include <chrono>
+#include <fstream>
+
+namespace {
+
+const char CH_MAGIC[4] = {'M', 'M', 'C', 'H'};
+// 2: the graph fingerprint covers edge targets and weights
+const uint32_t CH_VERSION = 2;
+
+// Settle limits of the local witness searches. Stopping early only costs
+// extra shortcuts, never correctness.
+const int WITNESS_SETTLE_LIMIT = 500;
+const int SIMULATE_SETTLE_LIMIT = 100;
+
+struct WorkEdge{
+    int32_t to;
+    float w;
+    int32_t mid;
+};
+
+// Mutable undirected graph the contraction works on.
+class Contractor
+{
+public:
+    Contractor(const CSRGraph &g) : N(g.numNodes()), adj(N), contracted(N, 0), deleted(N, 0), level(N, 0){
+        for (int u = 0; u < N; u++) {
+            adj[u].reserve(g.degree(u));
+            for (uint32_t e = g.edgeBegin(u); e < g.edgeEnd(u); e++)
+                adj[u].push_back({g.target(e), g.weight(e), -1});
+        }
+        witness.resize(N);
+        targetMark.assign(N, 0);
+    }
+
+    // Number of shortcuts contracting v would need; adds them unless simulating.
+    int contract(int v, bool simulate){
+        const vector<WorkEdge> &nb = adj[v];
+        int count = 0;
+        int limit = simulate ? SIMULATE_SETTLE_LIMIT : WITNESS_SETTLE_LIMIT;
+
+        for (size_t i = 0; i + 1 < nb.size(); i++) {
+            double maxVia = 0.0;
+            for (size_t j = i + 1; j < nb.size(); j++)
+                maxVia = max(maxVia, (double)nb[i].w + nb[j].w);
+
+            pendingTargets = 0;
+            markStamp++;
+            for (size_t j = i + 1; j < nb.size(); j++) {
+                if (targetMark[nb[j].to] != markStamp) { targetMark[nb[j].to] = markStamp; pendingTargets++; }
+            }
+            witnessSearch(nb[i].to, v, maxVia, limit);
+
+            for (size_t j = i + 1; j < nb.size(); j++) {
+                double via = (double)nb[i].w + nb[j].w;
+                if (witness.distance(nb[j].to) <= via) continue;
+                count++;
+                if (!simulate) pending.push_back({nb[i].to, nb[j].to, via});
+            }
+        }
+
+        if (!simulate) {
+            for (const auto &s : pending) {
+                addOrImprove(s.a, s.b, (float)s.w, v);
+                addOrImprove(s.b, s.a, (float)s.w, v);
+            }
+            pending.clear();
+        }
+        return count;
+    }
+
+    // Shortcuts added per edge removed (scaled), plus the usual uniformity
+    // terms: contracted neighbours and hierarchy depth.
+    int priority(int v){
+        int shortcuts = contract(v, true);
+        int quotient = (int)(1000.0 * shortcuts / (adj[v].size() + 1));
+        return quotient + deleted[v] + level[v];
+    }
+
+    // Removes v from the remaining graph and returns its upward edges.
+    vector<WorkEdge> remove(int v){
+        vector<WorkEdge> up;
+        up.swap(adj[v]);
+        contracted[v] = 1;
+        for (const auto &e : up) {
+            auto &list = adj[e.to];
+            for (size_t k = 0; k < list.size(); k++) {
+                if (list[k].to == v) { list[k] = list.back(); list.pop_back(); break; }
+            }
+            deleted[e.to]++;
+            level[e.to] = max(level[e.to], level[v] + 1);
+        }
+        return up;
+    }
+
+    const vector<WorkEdge> &neighbours(int v) const { return adj[v]; }
+
+private:
+    struct Shortcut{ int a, b; double w; };
+
+    int N;
+    vector<vector<WorkEdge>> adj;
+    vector<char> contracted;
+    vector<int> deleted;
+    vector<int> level;
+    SearchSpace witness;
+    vector<Shortcut> pending;
+    vector<uint32_t> targetMark; // == markStamp for targets of the current witness search
+    uint32_t markStamp = 0;
+    int pendingTargets = 0;
+
+    void witnessSearch(int source, int skip, double limit, int maxSettled){
+        witness.reset();
+        witness.label(source, 0.0, -1);
+        witness.push(0.0, source);
+        int settledCount = 0;
+
+        while (!witness.heapEmpty()) {
+            auto [d, u] = witness.pop();
+            if (witness.settled(u)) continue;
+            witness.settle(u);
+            if (d > limit || ++settledCount > maxSettled) break;
+            if (targetMark[u] == markStamp && --pendingTargets == 0) break;
+
+            for (const auto &e : adj[u]) {
+                if (e.to == skip) continue;
+                double nd = d + e.w;
+                if (nd < witness.distance(e.to)) {
+                    witness.label(e.to, nd, u);
+                    witness.push(nd, e.to);
+                }
+            }
+        }
+    }
+
+    void addOrImprove(int from, int to, float w, int mid){
+        for (auto &e : adj[from]) {
+            if (e.to == to) {
+                if (w < e.w) { e.w = w; e.mid = mid; }
+                return;
+            }
+        }
+        adj[from].push_back({to, w, mid});
+    }
+};
+
+template<typename T>
+void writeArray(ofstream &out, const vector<T> &v){
+    out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+}
+
+template<typename T>
+bool readArray(ifstream &in, vector<T> &v, size_t n){
+    v.resize(n);
+    in.read(reinterpret_cast<char*>(v.data()), n * sizeof(T));
+    return (bool)in;
+}
+
+} // namespace
+
+//---------------Preprocessing----------------------------------------
+void ContractionHierarchy::build(const CSRGraph &g, bool verbose){
+    auto startTime = chrono::high_resolution_clock::now();
+    const int N = g.numNodes();
+
+    Contractor work(g);
+    vector<vector<WorkEdge>> up(N);
+    rank.assign(N, 0);
+
+    // Lazy-update priority queue: an entry is stale when its priority no
+    // longer matches current[v].
+    vector<int> current(N);
+    using P = pair<int, int>;
+    priority_queue<P, vector<P>, greater<P>> pq;
+    for (int v = 0; v < N; v++) {
+        current[v] = work.priority(v);
+        pq.push({current[v], v});
+    }
+
+    vector<char> done(N, 0);
+    uint32_t order = 0;
+    while (!pq.empty()) {
+        auto [prio, v] = pq.top();
+        pq.pop();
+        if (done[v] || prio != current[v]) continue;
+
+        // Re-evaluate; if v is no longer the cheapest, put it back.
+        int fresh = work.priority(v);
+        if (!pq.empty() && fresh > pq.top().first) {
+            current[v] = fresh;
+            pq.push({fresh, v});
+            continue;
+        }
+
+        work.contract(v, false);
+        up[v] = work.remove(v);
+        done[v] = 1;
+        rank[v] = order++;
+
+        for (const auto &e : up[v]) {
+            current[e.to] = work.priority(e.to);
+            pq.push({current[e.to], e.to});
+        }
+
+        if (verbose && order % 50000 == 0)
+            cout << "  contracted " << order << " / " << N << " nodes\n";
+    }
+
+    upOffsets.assign(N + 1, 0);
+    upTargets.clear();
+    upWeights.clear();
+    upMiddle.clear();
+    for (int v = 0; v < N; v++) {
+        upOffsets[v] = (uint32_t)upTargets.size();
+        for (const auto &e : up[v]) {
+            upTargets.push_back(e.to);
+            upWeights.push_back(e.w);
+            upMiddle.push_back(e.mid);
+        }
+    }
+    upOffsets[N] = (uint32_t)upTargets.size();
+    graphFingerprint = g.fingerprint();
+
+    if (verbose) {
+        chrono::duration<double> secs = chrono::high_resolution_clock::now() - startTime;
+        cout << "Contraction finished: " << N << " nodes, " << numUpEdges() << " upward edges ("
+             << numShortcuts() << " shortcuts) in " << secs.count() << " s\n";
+    }
+}
+
+size_t ContractionHierarchy::numShortcuts() const{
+    return count_if(upMiddle.begin(), upMiddle.end(), [](int32_t m){ return m >= 0; });
+}
+
+//---------------Serialization----------------------------------------
+bool ContractionHierarchy::save(const string &filename) const{
+    ofstream out(filename, ios::binary);
+    if (!out.is_open()) return false;
+
+    uint32_t n = (uint32_t)rank.size();
+    uint64_t m = upTargets.size();
+    out.write(CH_MAGIC, 4);
+    out.write(reinterpret_cast<const char*>(&CH_VERSION), sizeof(CH_VERSION));
+    out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+    out.write(reinterpret_cast<const char*>(&m), sizeof(m));
+    out.write(reinterpret_cast<const char*>(&graphFingerprint), sizeof(graphFingerprint));
+    writeArray(out, rank);
+    writeArray(out, upOffsets);
+    writeArray(out, upTargets);
+    writeArray(out, upWeights);
+    writeArray(out, upMiddle);
+    return (bool)out;
+}
+
+bool ContractionHierarchy::load(const string &filename, const CSRGraph &g){
+    ifstream in(filename, ios::binary);
+    if (!in.is_open()) return false;
+
+    char magic[4];
+    uint32_t version = 0, n = 0;
+    uint64_t m = 0, fingerprint = 0;
+    in.read(magic, 4);
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(&n), sizeof(n));
+    in.read(reinterpret_cast<char*>(&m), sizeof(m));
+    in.read(reinterpret_cast<char*>(&fingerprint), sizeof(fingerprint));
+    if (!in || !equal(magic, magic + 4, CH_MAGIC) || version != CH_VERSION)
+        return false;
+    if ((int)n != g.numNodes() || fingerprint != g.fingerprint())
+        return false; // built for a different graph or index order
+
+    bool ok = readArray(in, rank, n) && readArray(in, upOffsets, n + 1u)
+           && readArray(in, upTargets, m) && readArray(in, upWeights, m)
+           && readArray(in, upMiddle, m);
+    if (!ok) {
+        rank.clear();
+        return false;
+    }
+    graphFingerprint = fingerprint;
+    return true;
+}
+
+//---------------Query------------------------------------------------
+uint32_t ContractionHierarchy::findUpEdge(int low, int high) const{
+    uint32_t found = upOffsets[low];
+    float bestW = numeric_limits<float>::infinity();
+    for (uint32_t e = upOffsets[low]; e < upOffsets[low + 1]; e++) {
+        if (upTargets[e] == high && upWeights[e] < bestW) { bestW = upWeights[e]; found = e; }
+    }
+    return found;
+}
+
+void ContractionHierarchy::unpack(int u, int v, vector<int> &out) const{
+    // Explicit stack: shortcut nesting can be deep on large graphs.
+    vector<pair<int, int>> stack = {{u, v}};
+    while (!stack.empty()) {
+        auto [a, b] = stack.back();
+        stack.pop_back();
+
+        uint32_t e = rank[a] < rank[b] ? findUpEdge(a, b) : findUpEdge(b, a);
+        int mid = upMiddle[e];
+        if (mid < 0) {
+            out.push_back(b);
+            continue;
+        }
+        stack.push_back({mid, b});
+        stack.push_back({a, mid});
+    }
+}
+
+PathResult ContractionHierarchy::query(const CSRGraph &g, const vector<SearchEndpoint> &sources,
+                                       const vector<SearchEndpoint> &targets, SearchContext &ctx) const{
+    PathResult result;
+    if (empty()) return result;
+
+    vector<SearchEndpoint> start, goal;
+    if (!Algorithms::filterReachable(g, sources, targets, start, goal))
+        return result;
+
+    ctx.prepareBidirectional(g);
+    SearchSpace &F = ctx.forward;
+    SearchSpace &B = ctx.backward;
+
+    for (const auto &s : start) {
+        if (s.cost < F.distance(s.node)) { F.label(s.node, s.cost, -1); F.push(s.cost, s.node); }
+    }
+    for (const auto &t : goal) {
+        if (t.cost < B.distance(t.node)) { B.label(t.node, t.cost, -1); B.push(t.cost, t.node); }
+    }
+
+    double best = numeric_limits<double>::infinity();
+    int meet = -1;
+
+    auto startTime = chrono::high_resolution_clock::now();
+
+    // Both searches only go upwards in rank; a direction can stop once its
+    // smallest key is no better than the best meeting found so far.
+    while (true) {
+        double fMin = F.heapEmpty() ? numeric_limits<double>::infinity() : F.heapTop().key;
+        double bMin = B.heapEmpty() ? numeric_limits<double>::infinity() : B.heapTop().key;
+        if (min(fMin, bMin) >= best) break;
+
+        bool forwardStep = fMin <= bMin;
+        SearchSpace &S = forwardStep ? F : B;
+        const SearchSpace &other = forwardStep ? B : F;
+
+        auto [du, u] = S.pop();
+        if (S.settled(u)) continue;
+        S.settle(u);
+        result.stats.settled++;
+
+        if (other.reached(u) && du + other.distance(u) < best) {
+            best = du + other.distance(u);
+            meet = u;
+        }
+
+        for (uint32_t e = upOffsets[u]; e < upOffsets[u + 1]; e++) {
+            result.stats.relaxed++;
+            int v = upTargets[e];
+            double nd = du + upWeights[e];
+            if (nd < S.distance(v)) {
+                S.label(v, nd, u);
+                S.push(nd, v);
+            }
+        }
+    }
+
+    auto endTime = chrono::high_resolution_clock::now();
+    chrono::duration<double, milli> duration = endTime - startTime;
+    result.stats.timeMs = duration.count();
+
+    if (meet < 0) return result;
+
+    // Upward chains source -> meet and meet <- target, then unpack shortcuts.
+    vector<int> upChain;
+    for (int at = meet; at != -1; at = F.parentOf(at)) upChain.push_back(at);
+    reverse(upChain.begin(), upChain.end());
+    vector<int> downChain;
+    for (int at = meet; at != -1; at = B.parentOf(at)) downChain.push_back(at);
+
+    vector<int> path = {upChain.front()};
+    for (size_t i = 0; i + 1 < upChain.size(); i++) unpack(upChain[i], upChain[i + 1], path);
+    for (size_t i = 0; i + 1 < downChain.size(); i++) unpack(downChain[i], downChain[i + 1], path);
+
+    result.nodes.reserve(path.size());
+    result.coordinates.reserve(path.size());
+    for (int v : path) {
+        result.nodes.push_back(g.id(v));
+        result.coordinates.push_back({g.lat(v), g.lon(v)});
+    }
+
+    result.found = true;
+    result.distance = best - F.distance(upChain.front()) - B.distance(downChain.back())
+                    + Algorithms::endpointOffset(sources, upChain.front())
+                    + Algorithms::endpointOffset(targets, downChain.back());
+    return result;
+}
+
+void ContractionHierarchy::upwardSearch(const CSRGraph &g, const vector<SearchEndpoint> &seeds, SearchContext &ctx,
+                                        vector<pair<int, double>> &out) const{
+    out.clear();
+    ctx.prepare(g);
+    SearchSpace &S = ctx.forward;
+    for (const auto &s : seeds) {
+        if (s.offset < S.distance(s.node)) { S.label(s.node, s.offset, -1); S.push(s.offset, s.node); }
+    }
+    // No pruning: the meeting node of every pair has to be in both spaces
+    while (!S.heapEmpty()) {
+        auto [du, u] = S.pop();
+        if (S.settled(u)) continue;
+        S.settle(u);
+        out.push_back({u, du});
+        for (uint32_t e = upOffsets[u]; e < upOffsets[u + 1]; e++) {
+            int v = upTargets[e];
+            double nd = du + upWeights[e];
+            if (nd < S.distance(v)) {
+                S.label(v, nd, u);
+                S.push(nd, v);
+            }
+        }
+    }
+}
+
+vector<double> ContractionHierarchy::distanceMatrix(const CSRGraph &g, const vector<vector<SearchEndpoint>> &sources,
+                                                    const vector<vector<SearchEndpoint>> &targets, int threads) const{
+    const size_t T = targets.size();
+    vector<double> matrix(sources.size() * T, numeric_limits<double>::infinity());
+    if (empty() || T == 0) return matrix;
+
+    //-----Backward: buckets of (node, target, distance)-----
+    struct Bucket { int node; int target; double dist; };
+    vector<vector<Bucket>> parts(max(threads, 1));
+    int chunks = WorkerPool::shared().run(T, threads, [&](int c, size_t b, size_t e) {
+        SearchContext &ctx = SearchContext::local();
+        vector<pair<int, double>> space;
+        for (size_t j = b; j < e; j++) {
+            upwardSearch(g, targets[j], ctx, space);
+            for (const auto &p : space) parts[c].push_back({p.first, (int)j, p.second});
+        }
+    });
+    vector<Bucket> buckets;
+    for (int c = 0; c < chunks; c++) buckets.insert(buckets.end(), parts[c].begin(), parts[c].end());
+    vector<vector<Bucket>>().swap(parts);
+    sort(buckets.begin(), buckets.end(), [](const Bucket &a, const Bucket &b) { return a.node < b.node; });
+
+    //-----Forward: scan the buckets of every settled node-----
+    WorkerPool::shared().run(sources.size(), threads, [&](int, size_t b, size_t e) {
+        SearchContext &ctx = SearchContext::local();
+        vector<pair<int, double>> space;
+        for (size_t i = b; i < e; i++) {
+            upwardSearch(g, sources[i], ctx, space);
+            double *row = matrix.data() + i * T;
+            for (const auto &p : space) {
+                auto it = lower_bound(buckets.begin(), buckets.end(), p.first,
+                                      [](const Bucket &x, int node) { return x.node < node; });
+                for (; it != buckets.end() && it->node == p.first; ++it)
+                    row[it->target] = min(row[it->target], p.second + it->dist);
+            }
+        }
+    });
+    return matrix;
+}
@@ -0,0 +1,304 @@
+#include "CSRGraph.h"
+#include "Graph.h"
+#include "Parallel.h"
+#include <atomic>
+#include <cstring>
+
+//---------------------Build from Graph------------------------------
+void CSRGraph::build(const Graph &g){
+    clear();
+
+    const auto &adj = g.get_adjList();
+    const auto &nodes = g.get_nodes();
+    const int N = (int)g.indexToId.size();
+
+    ids = g.indexToId;
+    lats.assign(N, 0.0);
+    lons.assign(N, 0.0);
+    offsets.assign(N + 1, 0);
+
+    // Neighbour lists loaded from nodes.txt contain every edge more than once
+    // (adEdge is called from both endpoints), so each list is sorted and
+    // parallel edges collapse to the cheapest one.
+    vector<pair<int32_t, float>> scratch;
+    size_t M = 0;
+    for (const auto &p : adj) M += p.second.size();
+    targets.reserve(M);
+    weights.reserve(M);
+
+    for (int u = 0; u < N; u++) {
+        long long uId = ids[u];
+
+        auto nit = nodes.find(uId);
+        if (nit != nodes.end()) {
+            lats[u] = nit->second.get_latitude();
+            lons[u] = nit->second.get_longitude();
+        }
+
+        offsets[u] = (uint32_t)targets.size();
+
+        auto ait = adj.find(uId);
+        if (ait == adj.end()) continue;
+
+        scratch.clear();
+        for (const auto &nbr : ait->second) {
+            auto vit = g.idToIndex.find(nbr.first);
+            if (vit == g.idToIndex.end() || vit->second == u) continue;
+            scratch.push_back({vit->second, (float)nbr.second});
+        }
+        sort(scratch.begin(), scratch.end());
+
+        for (size_t i = 0; i < scratch.size(); i++) {
+            if (i > 0 && scratch[i].first == scratch[i - 1].first) continue;
+            targets.push_back(scratch[i].first);
+            weights.push_back(scratch[i].second);
+        }
+    }
+    offsets[N] = (uint32_t)targets.size();
+    targets.shrink_to_fit();
+    weights.shrink_to_fit();
+
+    finishBuild();
+}
+
+//---------------------Build from edge list--------------------------
+void CSRGraph::build(vector<long long> nodeIds, vector<double> nodeLats, vector<double> nodeLons,
+                     const vector<CSREdge> &edges, int threads){
+    clear();
+    const size_t N = nodeIds.size();
+    ids = std::move(nodeIds);
+    lats = std::move(nodeLats);
+    lons = std::move(nodeLons);
+
+    // Parallel counting sort of both directions by source node. Slots of
+    // one node are filled in arbitrary order; sorting them afterwards keeps
+    // the result independent of the thread count.
+    vector<atomic<uint32_t>> cursor(N);
+    parallelChunks(N, threads, [&](int, size_t b, size_t e) {
+        for (size_t u = b; u < e; u++) cursor[u].store(0, memory_order_relaxed);
+    });
+    parallelChunks(edges.size(), threads, [&](int, size_t b, size_t e) {
+        for (size_t i = b; i < e; i++) {
+            if (edges[i].from == edges[i].to) continue;
+            cursor[edges[i].from].fetch_add(1, memory_order_relaxed);
+            cursor[edges[i].to].fetch_add(1, memory_order_relaxed);
+        }
+    });
+
+    vector<uint32_t> begin(N + 1, 0);
+    for (size_t u = 0; u < N; u++) begin[u] = cursor[u].load(memory_order_relaxed);
+    const uint32_t slotCount = parallelExclusiveScan(begin, threads);
+    begin[N] = slotCount;
+    parallelChunks(N, threads, [&](int, size_t b, size_t e) {
+        for (size_t u = b; u < e; u++) cursor[u].store(begin[u], memory_order_relaxed);
+    });
+
+    vector<pair<int32_t, float>> slots(slotCount);
+    parallelChunks(edges.size(), threads, [&](int, size_t b, size_t e) {
+        for (size_t i = b; i < e; i++) {
+            const CSREdge &edge = edges[i];
+            if (edge.from == edge.to) continue;
+            slots[cursor[edge.from].fetch_add(1, memory_order_relaxed)] = {edge.to, edge.weight};
+            slots[cursor[edge.to].fetch_add(1, memory_order_relaxed)] = {edge.from, edge.weight};
+        }
+    });
+    vector<atomic<uint32_t>>().swap(cursor);
+
+    // Sort each neighbour list, count the distinct targets, then compact
+    // into the final arrays at prefix-summed offsets.
+    offsets.assign(N + 1, 0);
+    parallelChunks(N, threads, [&](int, size_t b, size_t e) {
+        for (size_t u = b; u < e; u++) {
+            auto first = slots.begin() + begin[u], last = slots.begin() + begin[u + 1];
+            sort(first, last);
+            uint32_t distinct = 0;
+            for (auto it = first; it != last; ++it)
+                if (it == first || it->first != (it - 1)->first) distinct++;
+            offsets[u] = distinct;
+        }
+    });
+    const uint32_t M = parallelExclusiveScan(offsets, threads);
+    offsets[N] = M;
+
+    targets.resize(M);
+    weights.resize(M);
+    parallelChunks(N, threads, [&](int, size_t b, size_t e) {
+        for (size_t u = b; u < e; u++) {
+            uint32_t out = offsets[u];
+            for (uint32_t i = begin[u]; i < begin[u + 1]; i++) {
+                if (i != begin[u] && slots[i].first == slots[i - 1].first) continue;
+                targets[out] = slots[i].first;
+                weights[out] = slots[i].second;
+                out++;
+            }
+        }
+    });
+
+    finishBuild(threads);
+}
+
+void CSRGraph::finishBuild(int threads){
+    const int N = (int)ids.size();
+    byId.resize(N);
+    for (int i = 0; i < N; i++) byId[i] = i;
+    parallelSort(byId.begin(), byId.end(), threads, [this](int32_t a, int32_t b){ return ids[a] < ids[b]; });
+
+    buildComponents();
+    bindOwned();
+    a.fingerprint = computeFingerprint();
+}
+
+void CSRGraph::bindOwned(){
+    owner.reset();
+    a.numNodes = (int32_t)ids.size();
+    a.numEdges = targets.size();
+    a.numComponents = (int32_t)componentSizes.size();
+    a.largestComponent = -1;
+    for (int32_t c = 0; c < a.numComponents; c++)
+        if (a.largestComponent == -1 || componentSizes[c] > componentSizes[a.largestComponent]) a.largestComponent = c;
+
+    a.offsets = offsets.data();
+    a.targets = targets.data();
+    a.weights = weights.data();
+    a.lats = lats.data();
+    a.lons = lons.data();
+    a.ids = ids.data();
+    a.byId = byId.data();
+    a.components = components.data();
+    a.componentSizes = componentSizes.data();
+}
+
+CSRGraph &CSRGraph::operator=(const CSRGraph &other){
+    if (this == &other) return *this;
+    offsets = other.offsets;
+    targets = other.targets;
+    weights = other.weights;
+    lats = other.lats;
+    lons = other.lons;
+    ids = other.ids;
+    byId = other.byId;
+    components = other.components;
+    componentSizes = other.componentSizes;
+    if (other.owner) {
+        a = other.a;
+        owner = other.owner;
+    } else if (other.a.numNodes > 0) {
+        bindOwned();
+        a.fingerprint = other.a.fingerprint;
+    } else {
+        owner.reset();
+        a = CSRArrays();
+    }
+    return *this;
+}
+
+void CSRGraph::attach(const CSRArrays &view, shared_ptr<const void> keepAlive){
+    clear();
+    a = view;
+    owner = std::move(keepAlive);
+}
+
+//---------------------Connected components--------------------------
+void CSRGraph::buildComponents(){
+    const int N = (int)ids.size();
+    components.assign(N, -1);
+    componentSizes.clear();
+
+    // Plain BFS; the adjacency is symmetric so one sweep labels everything.
+    vector<int32_t> queue;
+    queue.reserve(N);
+    for (int s = 0; s < N; s++) {
+        if (components[s] != -1) continue;
+
+        int32_t c = (int32_t)componentSizes.size();
+        queue.clear();
+        queue.push_back(s);
+        components[s] = c;
+        for (size_t head = 0; head < queue.size(); head++) {
+            int u = queue[head];
+            for (uint32_t e = offsets[u]; e < offsets[u + 1]; e++) {
+                int v = targets[e];
+                if (components[v] == -1) {
+                    components[v] = c;
+                    queue.push_back(v);
+                }
+            }
+        }
+        componentSizes.push_back((int32_t)queue.size());
+    }
+}
+
+void CSRGraph::clear(){
+    offsets.clear();
+    targets.clear();
+    weights.clear();
+    lats.clear();
+    lons.clear();
+    ids.clear();
+    byId.clear();
+    components.clear();
+    componentSizes.clear();
+    owner.reset();
+    a = CSRArrays();
+}
+
+int CSRGraph::indexOf(long long osmId) const{
+    const int32_t *first = a.byId, *last = a.byId + a.numNodes;
+    const long long *idv = a.ids;
+    auto it = lower_bound(first, last, osmId,
+                          [idv](int32_t idx, long long key){ return idv[idx] < key; });
+    if (it == last || idv[*it] != osmId) return -1;
+    return *it;
+}
+
+//---------------------Haversine------------------------------------
+double CSRGraph::haversine(int a, int b) const{
+    return haversine(lat(a), lon(a), lat(b), lon(b));
+}
+
+double CSRGraph::haversine(double lat1, double lon1, double lat2, double lon2){
+    #ifndef M_PI
+    #define M_PI 3.14159265358979323846
+    #endif
+    const double R = 6371000;
+    const double toRad = M_PI / 180.0;
+
+    double dLat = (lat2 - lat1) * toRad;
+    double dLon = (lon2 - lon1) * toRad;
+    lat1 *= toRad;
+    lat2 *= toRad;
+
+    double s1 = sin(dLat/2), s2 = sin(dLon/2);
+    double h = s1 * s1 + s2 * s2 * cos(lat1) * cos(lat2);
+    return 2 * R * atan2(sqrt(h), sqrt(1-h));
+}
+
+uint64_t CSRGraph::computeFingerprint() const{
+    uint64_t h = 1469598103934665603ULL;
+    auto mix = [&h](uint64_t x){
+        for (int i = 0; i < 8; i++) {
+            h ^= (x >> (i * 8)) & 0xff;
+            h *= 1099511628211ULL;
+        }
+    };
+    mix((uint64_t)a.numNodes);
+    mix(a.numEdges);
+    for (int i = 0; i < a.numNodes; i++) mix((uint64_t)a.ids[i]);
+    for (int i = 0; i <= a.numNodes && a.offsets; i++) mix(a.offsets[i]);
+    // Same ids and degrees are not the same graph: every edge's target and
+    // length count too
+    for (uint64_t e = 0; e < a.numEdges; e++) {
+        uint32_t bits;
+        memcpy(&bits, &a.weights[e], sizeof(bits));
+        mix(((uint64_t)(uint32_t)a.targets[e] << 32) | bits);
+    }
+    return h;
+}
+
+size_t CSRGraph::memoryBytes() const{
+    size_t N = a.numNodes, M = a.numEdges;
+    return (N + 1) * sizeof(uint32_t)
+         + M * (sizeof(int32_t) + sizeof(float))
+         + N * (2 * sizeof(double) + sizeof(long long) + 2 * sizeof(int32_t))
+         + a.numComponents * sizeof(int32_t);
+}
@@ -0,0 +1,155 @@
+#include "EdgeIndex.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const double EARTH_RADIUS_M = 6371000.0;
+const double DEG_TO_RAD = 3.14159265358979323846 / 180.0;
+
+} // namespace
+
+void EdgeIndex::project(double lat, double lon, double &x, double &y) const{
+    x = EARTH_RADIUS_M * lon * DEG_TO_RAD * refCos;
+    y = EARTH_RADIUS_M * lat * DEG_TO_RAD;
+}
+
+int EdgeIndex::cellX(double x) const{
+    return max(0, min(nx - 1, (int)floor((x - minX) / cellSize)));
+}
+
+int EdgeIndex::cellY(double y) const{
+    return max(0, min(ny - 1, (int)floor((y - minY) / cellSize)));
+}
+
+void EdgeIndex::clear(){
+    edgeU.clear();
+    edgeV.clear();
+    edgeWeight.clear();
+    edgeMain.clear();
+    ax.clear(); ay.clear(); bx.clear(); by.clear();
+    cellStart.clear();
+    cellEdges.clear();
+    nx = ny = 0;
+}
+
+void EdgeIndex::build(const CSRGraph &g){
+    clear();
+    const int N = g.numNodes();
+    if (N == 0) return;
+
+    double sumLat = 0.0;
+    for (int u = 0; u < N; u++) sumLat += g.lat(u);
+    refCos = cos(sumLat / N * DEG_TO_RAD);
+
+    // Each undirected edge once, from its lower index
+    const int mainComponent = g.largestComponent();
+    for (int u = 0; u < N; u++) {
+        for (uint32_t e = g.edgeBegin(u); e < g.edgeEnd(u); e++) {
+            int v = g.target(e);
+            if (v < u) continue;
+            edgeU.push_back(u);
+            edgeV.push_back(v);
+            edgeWeight.push_back(g.weight(e));
+            edgeMain.push_back(g.component(u) == mainComponent ? 1 : 0);
+            double x, y;
+            project(g.lat(u), g.lon(u), x, y);
+            ax.push_back(x); ay.push_back(y);
+            project(g.lat(v), g.lon(v), x, y);
+            bx.push_back(x); by.push_back(y);
+        }
+    }
+    const size_t M = edgeU.size();
+    if (M == 0) return;
+
+    double maxX, maxY;
+    minX = maxX = ax[0];
+    minY = maxY = ay[0];
+    for (size_t i = 0; i < M; i++) {
+        minX = min({minX, ax[i], bx[i]}); maxX = max({maxX, ax[i], bx[i]});
+        minY = min({minY, ay[i], by[i]}); maxY = max({maxY, ay[i], by[i]});
+    }
+
+    // About two edges per cell on average
+    const double width = max(maxX - minX, 1.0), height = max(maxY - minY, 1.0);
+    cellSize = max(10.0, sqrt(width * height / max<size_t>(1, M / 2)));
+    nx = (int)(width / cellSize) + 1;
+    ny = (int)(height / cellSize) + 1;
+
+    // Counting sort of (cell, edge) pairs
+    cellStart.assign((size_t)nx * ny + 1, 0);
+    auto forCells = [&](size_t i, auto fn) {
+        int x0 = cellX(min(ax[i], bx[i])), x1 = cellX(max(ax[i], bx[i]));
+        int y0 = cellY(min(ay[i], by[i])), y1 = cellY(max(ay[i], by[i]));
+        for (int cy = y0; cy <= y1; cy++)
+            for (int cx = x0; cx <= x1; cx++) fn((size_t)cy * nx + cx);
+    };
+    for (size_t i = 0; i < M; i++) forCells(i, [&](size_t c) { cellStart[c + 1]++; });
+    for (size_t c = 0; c + 1 < cellStart.size(); c++) cellStart[c + 1] += cellStart[c];
+    cellEdges.resize(cellStart.back());
+    vector<uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+    for (size_t i = 0; i < M; i++) forCells(i, [&](size_t c) { cellEdges[fill[c]++] = (uint32_t)i; });
+}
+
+EdgeSnap EdgeIndex::nearest(const CSRGraph &g, double lat, double lon, bool mainComponentOnly) const{
+    EdgeSnap snap;
+    if (empty()) return snap;
+
+    double qx, qy;
+    project(lat, lon, qx, qy);
+    const int cx = cellX(qx), cy = cellY(qy);
+
+    double bestD2 = numeric_limits<double>::infinity(), bestT = 0.0;
+    int64_t bestEdge = -1;
+    auto scanCell = [&](int x, int y) {
+        if (x < 0 || y < 0 || x >= nx || y >= ny) return;
+        size_t c = (size_t)y * nx + x;
+        for (uint32_t k = cellStart[c]; k < cellStart[c + 1]; k++) {
+            uint32_t i = cellEdges[k];
+            if (mainComponentOnly && !edgeMain[i]) continue;
+            double dx = bx[i] - ax[i], dy = by[i] - ay[i];
+            double len2 = dx * dx + dy * dy;
+            double t = len2 > 0 ? ((qx - ax[i]) * dx + (qy - ay[i]) * dy) / len2 : 0.0;
+            t = max(0.0, min(1.0, t));
+            double px = ax[i] + t * dx - qx, py = ay[i] + t * dy - qy;
+            double d2 = px * px + py * py;
+            if (d2 < bestD2) {
+                bestD2 = d2;
+                bestT = t;
+                bestEdge = i;
+            }
+        }
+    };
+
+    // Ring r holds the cells at Chebyshev distance r from the query's
+    // cell; none of them is closer than (r - 1) cells to the query.
+    const int maxRing = max(nx, ny);
+    for (int r = 0; r <= maxRing; r++) {
+        double reach = (r - 1) * cellSize;
+        if (r > 0 && reach > 0 && reach * reach >= bestD2) break;
+        for (int y = cy - r; y <= cy + r; y++) {
+            if (y == cy - r || y == cy + r) {
+                for (int x = cx - r; x <= cx + r; x++) scanCell(x, y);
+            } else {
+                scanCell(cx - r, y);
+                if (r > 0) scanCell(cx + r, y);
+            }
+        }
+    }
+    if (bestEdge < 0) return snap;
+
+    snap.u = edgeU[bestEdge];
+    snap.v = edgeV[bestEdge];
+    snap.t = bestT;
+    snap.weight = edgeWeight[bestEdge];
+    snap.lat = g.lat(snap.u) + bestT * (g.lat(snap.v) - g.lat(snap.u));
+    snap.lon = g.lon(snap.u) + bestT * (g.lon(snap.v) - g.lon(snap.u));
+    snap.distance = CSRGraph::haversine(lat, lon, snap.lat, snap.lon);
+    return snap;
+}
+
+size_t EdgeIndex::memoryBytes() const{
+    return edgeU.capacity() * sizeof(int32_t) * 2 + edgeWeight.capacity() * sizeof(float)
+         + edgeMain.capacity() + ax.capacity() * sizeof(double) * 4
+         + (cellStart.capacity() + cellEdges.capacity()) * sizeof(uint32_t);
+}
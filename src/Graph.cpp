@@ -65,6 +65,22 @@ void Graph::buildNodeIndexMapping() {
         indexToId.push_back(p.first);
         index++;
     }
+
+    csr.build(*this);
+}
+
+void Graph::releaseBuildData() {
+    unordered_map<long long, Node>().swap(nodes);
+    unordered_map<long long, vector<pair<long long, double>>>().swap(adjList);
+    unordered_map<long long, int>().swap(idToIndex);
+    vector<long long>().swap(indexToId);
+}
+
+const CSRGraph& Graph::get_csr() const {
+    return csr;
+}
+CSRGraph& Graph::get_csr() {
+    return csr;
 }
 const vector<pair<long long, double>>& Graph::getNeighbors(long long id) const {
     static const vector<pair<long long, double>> empty;
@@ -0,0 +1,174 @@
+#include "GraphLoader.h"
+#include "Snapshot.h"
+#include "Log.h"
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+// Load node coordinates 
+void loadNodeCoordinates(Graph &g, const std::string &filename)
+{
+    std::ifstream in(filename);
+    if (!in.is_open())
+    {
+        LOG_ERROR << "Failed to open node file" << logging::kv("file", filename);
+        return;
+    }
+
+    std::string line;
+    std::getline(in, line); // skip header
+
+    while (std::getline(in, line))
+    {
+        std::stringstream ss(line);
+        std::string idStr, latStr, lonStr;
+        if (!std::getline(ss, idStr, ',')) continue;
+        if (!std::getline(ss, latStr, ',')) continue;
+        if (!std::getline(ss, lonStr, ',')) continue;
+
+        try
+        {
+            long long id = std::stoll(idStr);
+            double lat = std::stod(latStr);
+            double lon = std::stod(lonStr);
+            g.addNode(id, lat, lon);
+        }
+        catch (...) { continue; }
+    }
+
+    LOG_INFO << "Node coordinates loaded" << logging::kv("file", filename);
+}
+
+// Load graph edges 
+Graph loadGraph(const std::string& filename, Graph& g) {
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+        LOG_ERROR << "Failed to open edge file" << logging::kv("file", filename);
+        return g;
+    }
+
+    std::string line;
+    long long currentNode = -1;
+
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        std::stringstream ss(line);
+        std::string token;
+        ss >> token;
+
+        if (token == "Node:") {
+            ss >> currentNode;
+            if (!g.get_nodes().count(currentNode))
+                g.addNode(currentNode, 0, 0); // placeholder
+        } else {
+            long long neighbor = std::stoll(token);
+            double weight; ss >> weight;
+
+            if (!g.get_nodes().count(neighbor))
+                g.addNode(neighbor, 0, 0); // placeholder
+
+            g.adEdge(currentNode, neighbor, weight);
+        }
+    }
+
+    LOG_INFO << "Graph edges loaded" << logging::kv("file", filename);
+    return g;
+}
+
+namespace {
+
+std::vector<KDPoint> csrPoints(const CSRGraph &csr)
+{
+    std::vector<KDPoint> kdpoints;
+    kdpoints.reserve(csr.numNodes());
+    for (int i = 0; i < csr.numNodes(); i++) {
+        KDPoint kp;
+        kp.id = i;
+        kp.lat = csr.lat(i);
+        kp.lon = csr.lon(i);
+        kdpoints.push_back(kp);
+    }
+    return kdpoints;
+}
+
+template<typename Index>
+void setSnapFlagsOn(const CSRGraph &csr, Index &index)
+{
+    const int mainComponent = csr.largestComponent();
+    index.setFlags([&](long long idx) {
+        uint8_t f = 0;
+        if (csr.degree((int)idx) > 0) f |= SNAP_HAS_NEIGHBOURS;
+        if (csr.component((int)idx) == mainComponent) f |= SNAP_MAIN_COMPONENT;
+        return f;
+    });
+}
+
+} // namespace
+
+void buildKDTree(const CSRGraph &csr, KDTree &kdt)
+{
+    kdt.build(csrPoints(csr));
+    setSnapFlags(csr, kdt);
+}
+
+void buildGridIndex(const CSRGraph &csr, GridIndex &grid)
+{
+    grid.build(csrPoints(csr));
+    setSnapFlags(csr, grid);
+}
+
+void setSnapFlags(const CSRGraph &csr, KDTree &kdt)
+{
+    setSnapFlagsOn(csr, kdt);
+}
+
+void setSnapFlags(const CSRGraph &csr, GridIndex &grid)
+{
+    setSnapFlagsOn(csr, grid);
+}
+
+bool loadRoutingData(Graph &g, KDTree &kdt, const std::string &snapshotFile,
+                     const std::string &csvFile, const std::string &txtFile,
+                     bool verifySnapshot)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+    auto elapsedMs = [&]() {
+        std::chrono::duration<double, std::milli> d = std::chrono::high_resolution_clock::now() - startTime;
+        return d.count();
+    };
+
+    std::vector<int32_t> kdOrder;
+    std::string error;
+    if (!snapshotFile.empty() && snapshot::load(snapshotFile, g.get_csr(), kdOrder, verifySnapshot, &error)) {
+        const CSRGraph &csr = g.get_csr();
+        std::vector<KDPoint> kdpoints;
+        kdpoints.reserve(kdOrder.size());
+        for (int32_t i : kdOrder) {
+            KDPoint kp;
+            kp.id = i;
+            kp.lat = csr.lat(i);
+            kp.lon = csr.lon(i);
+            kdpoints.push_back(kp);
+        }
+        kdt.buildInOrder(kdpoints);
+        setSnapFlags(csr, kdt);
+        LOG_INFO << "Graph snapshot mapped" << logging::kv("file", snapshotFile) << logging::kv("ms", elapsedMs());
+        return !csr.empty();
+    }
+    if (!snapshotFile.empty())
+        LOG_WARNING << "No usable snapshot, parsing text files" << logging::kv("file", snapshotFile)
+                    << logging::kv("error", error);
+
+    loadNodeCoordinates(g, csvFile);
+    loadGraph(txtFile, g);
+
+    g.buildNodeIndexMapping();
+    LOG_INFO << "Node index mapping built" << logging::kv("nodes", g.indexToId.size());
+
+    // Everything after loading runs on the frozen CSR graph; the hash-map
+    // adjacency is only needed while parsing.
+    g.releaseBuildData();
+    buildKDTree(g.get_csr(), kdt);
+    LOG_INFO << "Text graph loaded" << logging::kv("ms", elapsedMs());
+    return !g.get_csr().empty();
+}
@@ -0,0 +1,91 @@
+#include "GridIndex.h"
+#include "SpatialBatch.h"
+
+namespace {
+
+const double EARTH_RADIUS_M = 6371000.0;
+const double DEG_TO_RAD = 3.14159265358979323846 / 180.0;
+
+} // namespace
+
+void GridIndex::project(double lat, double lon, double &x, double &y) const {
+    x = EARTH_RADIUS_M * lon * DEG_TO_RAD * refCos;
+    y = EARTH_RADIUS_M * lat * DEG_TO_RAD;
+}
+
+void GridIndex::build(const std::vector<KDPoint> &points, double pointsPerCell) {
+    xs.clear();
+    ys.clear();
+    ids.clear();
+    flags.clear();
+    cellStart.clear();
+    nx = ny = 0;
+    const size_t n = points.size();
+    if (n == 0) return;
+
+    // Same reference latitude as KDTree, so both see identical distances
+    double sumLat = 0.0;
+    for (const auto &p : points) sumLat += p.lat;
+    refCos = std::cos(sumLat / n * DEG_TO_RAD);
+
+    std::vector<double> px(n), py(n);
+    for (size_t i = 0; i < n; i++) project(points[i].lat, points[i].lon, px[i], py[i]);
+    double maxX, maxY;
+    minX = maxX = px[0];
+    minY = maxY = py[0];
+    for (size_t i = 0; i < n; i++) {
+        minX = std::min(minX, px[i]); maxX = std::max(maxX, px[i]);
+        minY = std::min(minY, py[i]); maxY = std::max(maxY, py[i]);
+    }
+
+    const double width = std::max(maxX - minX, 1.0), height = std::max(maxY - minY, 1.0);
+    const double cells = std::max(1.0, n / std::max(pointsPerCell, 1.0));
+    cellSize = std::max(1.0, std::sqrt(width * height / cells));
+    nx = (int)(width / cellSize) + 1;
+    ny = (int)(height / cellSize) + 1;
+
+    // Counting sort by cell; points keep their input order within a cell
+    std::vector<uint32_t> cellOf(n);
+    cellStart.assign((size_t)nx * ny + 1, 0);
+    for (size_t i = 0; i < n; i++) {
+        cellOf[i] = (uint32_t)((size_t)cellY(py[i]) * nx + cellX(px[i]));
+        cellStart[cellOf[i] + 1]++;
+    }
+    for (size_t c = 0; c + 1 < cellStart.size(); c++) cellStart[c + 1] += cellStart[c];
+
+    xs.resize(n);
+    ys.resize(n);
+    ids.resize(n);
+    std::vector<uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+    for (size_t i = 0; i < n; i++) {
+        uint32_t at = fill[cellOf[i]]++;
+        xs[at] = px[i];
+        ys[at] = py[i];
+        ids[at] = points[i].id;
+    }
+}
+
+size_t GridIndex::memoryBytes() const {
+    return xs.capacity() * sizeof(double) + ys.capacity() * sizeof(double)
+         + ids.capacity() * sizeof(long long) + flags.capacity() + cellStart.capacity() * sizeof(uint32_t);
+}
+
+long long GridIndex::nearest(double lat, double lon) const {
+    return nearestAt(lat, lon, [](size_t){ return true; });
+}
+
+std::vector<long long> GridIndex::kNearest(double lat, double lon, int k) const {
+    return kNearestAt(lat, lon, k, [](size_t){ return true; });
+}
+
+std::vector<std::vector<long long>> GridIndex::kNearestBatch(const std::vector<std::pair<double, double>> &queries, int k,
+                                                             uint8_t required, int threads) const {
+    return batchQuery(queries, threads, [&](double lat, double lon) {
+        return required == 0 ? kNearest(lat, lon, k) : kNearestFlagged(lat, lon, k, required);
+    });
+}
+
+std::vector<long long> GridIndex::nearestBatch(const std::vector<std::pair<double, double>> &queries,
+                                               uint8_t required, int threads) const {
+    return firstOfEach(kNearestBatch(queries, 1, required, threads));
+}
@@ -0,0 +1,93 @@
+#include "Landmarks.h"
+#include <cmath>
+
+namespace {
+
+// Full Dijkstra from source, writing every settled distance into out.
+void fullDijkstra(const CSRGraph &g, int source, SearchContext &ctx, vector<double> &out){
+    ctx.prepare(g);
+    SearchSpace &S = ctx.forward;
+    out.assign(g.numNodes(), numeric_limits<double>::infinity());
+
+    S.label(source, 0.0, -1);
+    S.push(0.0, source);
+    while (!S.heapEmpty()) {
+        auto [d, u] = S.pop();
+        if (S.settled(u)) continue;
+        S.settle(u);
+        out[u] = d;
+
+        for (uint32_t e = g.edgeBegin(u); e < g.edgeEnd(u); e++) {
+            int v = g.target(e);
+            double nd = d + g.weight(e);
+            if (nd < S.distance(v)) {
+                S.label(v, nd, u);
+                S.push(nd, v);
+            }
+        }
+    }
+}
+
+} // namespace
+
+void Landmarks::build(const CSRGraph &g, int count, SearchContext &ctx){
+    clear();
+    const int N = g.numNodes();
+    if (N == 0 || count <= 0) return;
+
+    const int main = g.largestComponent();
+    count = min(count, g.componentSize(main));
+
+    // Farthest selection: start from the node farthest from an arbitrary
+    // node of the main component, then always add the node farthest from
+    // all landmarks chosen so far.
+    int seed = 0;
+    while (g.component(seed) != main) seed++;
+
+    vector<double> dist;
+    fullDijkstra(g, seed, ctx, dist);
+    int next = seed;
+    for (int v = 0; v < N; v++)
+        if (dist[v] != numeric_limits<double>::infinity() && dist[v] > dist[next]) next = v;
+
+    vector<double> minDist(N, numeric_limits<double>::infinity());
+    vector<vector<float>> columns;
+    columns.reserve(count);
+
+    while ((int)landmarks.size() < count) {
+        landmarks.push_back(next);
+        fullDijkstra(g, next, ctx, dist);
+        columns.emplace_back(dist.begin(), dist.end());
+
+        next = -1;
+        for (int v = 0; v < N; v++) {
+            minDist[v] = min(minDist[v], dist[v]);
+            if (minDist[v] == numeric_limits<double>::infinity()) continue;
+            if (next == -1 || minDist[v] > minDist[next]) next = v;
+        }
+        if (next == -1 || minDist[next] == 0.0) break; // every node is a landmark
+    }
+
+    // Transpose to node-major rows.
+    const int k = (int)landmarks.size();
+    table.assign((size_t)N * k, 0.0f);
+    for (int i = 0; i < k; i++)
+        for (int v = 0; v < N; v++)
+            table[(size_t)v * k + i] = columns[i][v];
+}
+
+void Landmarks::clear(){
+    landmarks.clear();
+    table.clear();
+}
+
+double Landmarks::lowerBound(int a, int b) const{
+    const float *ra = row(a);
+    const float *rb = row(b);
+    double best = 0.0;
+    for (int i = 0; i < count(); i++) {
+        if (std::isinf(ra[i]) || std::isinf(rb[i])) continue;
+        best = max(best, (double)fabs(ra[i] - rb[i]));
+    }
+    return best;
+}
@@ -0,0 +1,247 @@
+#include "Log.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace logging {
+
+atomic<int> currentLevel{(int)Level::Info};
+
+namespace {
+
+atomic<FILE*> output{stdout};
+
+struct Record
+{
+    Level level;
+    uint32_t thread;
+    chrono::system_clock::time_point time;
+    string text; // msg="..." plus fields
+};
+
+// Bounded MPSC ring (Vyukov's sequence-numbered slots). A producer claims
+// a position by advancing tail with a CAS, fills the slot and publishes it
+// by bumping the slot's sequence; the single consumer reads slots in order.
+class Ring
+{
+public:
+    explicit Ring(size_t capacityPow2) : slots(capacityPow2), mask(capacityPow2 - 1) {
+        for (size_t i = 0; i < slots.size(); i++) slots[i].seq.store(i, memory_order_relaxed);
+    }
+
+    bool push(Record &&r) {
+        size_t pos = tail.load(memory_order_relaxed);
+        for (;;) {
+            Slot &s = slots[pos & mask];
+            size_t seq = s.seq.load(memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = tail.load(memory_order_relaxed);
+            }
+        }
+        Slot &s = slots[pos & mask];
+        s.rec = std::move(r);
+        s.seq.store(pos + 1, memory_order_release);
+        return true;
+    }
+
+    // Consumer only
+    bool pop(Record &out) {
+        Slot &s = slots[head & mask];
+        if (s.seq.load(memory_order_acquire) != head + 1) return false;
+        out = std::move(s.rec);
+        s.seq.store(head + slots.size(), memory_order_release);
+        head++;
+        return true;
+    }
+
+private:
+    struct Slot
+    {
+        atomic<size_t> seq;
+        Record rec;
+    };
+    vector<Slot> slots;
+    const size_t mask;
+    alignas(64) atomic<size_t> tail{0};
+    alignas(64) size_t head = 0;
+};
+
+const char *levelName(Level level) {
+    switch (level) {
+        case Level::Debug: return "debug";
+        case Level::Info: return "info";
+        case Level::Warning: return "warning";
+        default: return "error";
+    }
+}
+
+class Writer
+{
+public:
+    Writer() : ring(8192), worker([this] { run(); }) {}
+
+    ~Writer() {
+        {
+            lock_guard<mutex> g(lock);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    void push(Record &&r) {
+        if (!ring.push(std::move(r))) {
+            droppedLines.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+        // Only wake the writer when it is asleep; the common case is a
+        // single load on the producer side.
+        if (sleeping.load(memory_order_acquire)) wake.notify_one();
+    }
+
+    void flush() {
+        unique_lock<mutex> g(lock);
+        size_t target = ++flushRequests;
+        wake.notify_one();
+        flushed.wait(g, [&] { return flushesDone >= target || stopping; });
+    }
+
+    atomic<size_t> droppedLines{0};
+
+private:
+    Ring ring;
+    mutex lock;
+    condition_variable wake, flushed;
+    atomic<bool> sleeping{false};
+    bool stopping = false;
+    size_t flushRequests = 0, flushesDone = 0;
+    thread worker;
+
+    void drain(string &buf) {
+        Record r;
+        while (ring.pop(r)) {
+            time_t secs = chrono::system_clock::to_time_t(r.time);
+            long ms = (long)(chrono::duration_cast<chrono::milliseconds>(r.time.time_since_epoch()).count() % 1000);
+            tm utc;
+            gmtime_r(&secs, &utc);
+            char stamp[40];
+            size_t n = strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &utc);
+            snprintf(stamp + n, sizeof(stamp) - n, ".%03ldZ", ms);
+            buf += stamp;
+            buf += " level=";
+            buf += levelName(r.level);
+            buf += " thread=";
+            buf += to_string(r.thread);
+            buf += ' ';
+            buf += r.text;
+            buf += '\n';
+        }
+        if (!buf.empty()) {
+            FILE *out = output.load(memory_order_relaxed);
+            fwrite(buf.data(), 1, buf.size(), out);
+            fflush(out);
+            buf.clear();
+        }
+    }
+
+    void run() {
+        string buf;
+        for (;;) {
+            drain(buf);
+            unique_lock<mutex> g(lock);
+            if (flushesDone < flushRequests) {
+                g.unlock();
+                drain(buf);
+                g.lock();
+                flushesDone = flushRequests;
+                flushed.notify_all();
+            }
+            if (stopping) {
+                g.unlock();
+                drain(buf);
+                return;
+            }
+            // A producer that pushed just before sleeping was set is picked
+            // up by the timeout at the latest.
+            sleeping.store(true, memory_order_release);
+            wake.wait_for(g, chrono::milliseconds(50));
+            sleeping.store(false, memory_order_relaxed);
+        }
+    }
+};
+
+Writer &writer() {
+    static Writer w;
+    return w;
+}
+
+uint32_t threadNumber() {
+    static atomic<uint32_t> next{1};
+    thread_local uint32_t id = next.fetch_add(1, memory_order_relaxed);
+    return id;
+}
+
+void quoteInto(ostringstream &out, const string &s) {
+    out << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if (c == '\n') out << "\\n";
+        else out << c;
+    }
+    out << '"';
+}
+
+} // namespace
+
+void setLevel(Level level) {
+    currentLevel.store((int)level, memory_order_relaxed);
+}
+
+void setOutput(FILE *out) {
+    output.store(out, memory_order_relaxed);
+}
+
+bool parseLevel(const string &name, Level &out) {
+    if (name == "debug") out = Level::Debug;
+    else if (name == "info") out = Level::Info;
+    else if (name == "warning") out = Level::Warning;
+    else if (name == "error") out = Level::Error;
+    else return false;
+    return true;
+}
+
+Line &Line::operator<<(const Field<string> &f) {
+    fields << ' ' << f.key << '=';
+    // Strings are quoted only when they need to be
+    if (f.value.empty() || f.value.find_first_of(" \"=\\\n") != string::npos) quoteInto(fields, f.value);
+    else fields << f.value;
+    return *this;
+}
+
+Line::~Line() {
+    ostringstream text;
+    text << "msg=";
+    quoteInto(text, msg.str());
+    text << fields.str();
+    writer().push({level, threadNumber(), chrono::system_clock::now(), text.str()});
+}
+
+size_t dropped() {
+    return writer().droppedLines.load(memory_order_relaxed);
+}
+
+void flush() {
+    writer().flush();
+}
+
+}
@@ -0,0 +1,197 @@
+#include "Metrics.h"
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+namespace metrics {
+namespace {
+
+const size_t MAX_SLOTS = 2048;
+
+enum class Kind { COUNTER, GAUGE, HISTOGRAM };
+
+struct Info
+{
+    Kind kind;
+    string name;
+    string help;
+    string labels;
+    size_t slot;
+    vector<double> bounds;
+};
+
+struct Shard
+{
+    atomic<uint64_t> cells[MAX_SLOTS];
+    Shard() { for (auto &c : cells) c.store(0, memory_order_relaxed); }
+};
+
+// Owner-only update: the shard's thread is the single writer, so a load
+// and a store are enough and readers see either value.
+inline void bump(atomic<uint64_t> &cell, uint64_t n) {
+    cell.store(cell.load(memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+struct Registry
+{
+    mutex lock;
+    vector<Info> infos;
+    vector<unique_ptr<Shard>> shards;
+    vector<Shard *> idle;   // shards of exited threads, handed to new ones
+    size_t used = 0;
+
+    size_t add(Kind kind, const string &name, const string &help, const string &labels,
+               const vector<double> &bounds, size_t slots) {
+        lock_guard<mutex> g(lock);
+        if (used + slots > MAX_SLOTS) throw runtime_error("metrics: out of slots for " + name);
+        infos.push_back({kind, name, help, labels, used, bounds});
+        used += slots;
+        return infos.back().slot;
+    }
+};
+
+Registry &registry() {
+    static Registry r;
+    return r;
+}
+
+// A thread's claim on one shard. The shard keeps its counts when the
+// thread exits and goes to the next thread that starts recording; it is
+// still summed by render() in the meantime, so totals never drop.
+struct ShardLease
+{
+    Shard *shard = nullptr;
+    ~ShardLease() {
+        if (!shard) return;
+        Registry &r = registry();
+        lock_guard<mutex> g(r.lock);
+        r.idle.push_back(shard);
+    }
+};
+
+Shard &localShard() {
+    thread_local ShardLease lease;
+    if (!lease.shard) {
+        Registry &r = registry();
+        lock_guard<mutex> g(r.lock);
+        if (!r.idle.empty()) {
+            lease.shard = r.idle.back();
+            r.idle.pop_back();
+        } else {
+            r.shards.push_back(make_unique<Shard>());
+            lease.shard = r.shards.back().get();
+        }
+    }
+    return *lease.shard;
+}
+
+double asDouble(uint64_t bits) {
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+uint64_t asBits(double d) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(d));
+    return bits;
+}
+
+string withLabels(const string &labels, const string &extra = "") {
+    if (labels.empty() && extra.empty()) return "";
+    if (labels.empty()) return "{" + extra + "}";
+    if (extra.empty()) return "{" + labels + "}";
+    return "{" + labels + "," + extra + "}";
+}
+
+} // namespace
+
+Counter::Counter(const string &name, const string &help, const string &labels)
+    : slot(registry().add(Kind::COUNTER, name, help, labels, {}, 1)) {}
+
+void Counter::inc(uint64_t n) const {
+    bump(localShard().cells[slot], n);
+}
+
+Gauge::Gauge(const string &name, const string &help, const string &labels)
+    : slot(registry().add(Kind::GAUGE, name, help, labels, {}, 1)) {}
+
+void Gauge::add(int64_t n) const {
+    bump(localShard().cells[slot], (uint64_t)n); // wraps; summed as signed
+}
+
+Histogram::Histogram(const string &name, const string &help, vector<double> b, const string &labels)
+    : bounds(std::move(b)) {
+    slot = registry().add(Kind::HISTOGRAM, name, help, labels, bounds, bounds.size() + 3);
+}
+
+void Histogram::observe(double value) const {
+    Shard &s = localShard();
+    size_t b = 0;
+    while (b < bounds.size() && value > bounds[b]) b++;
+    bump(s.cells[slot + b], 1);
+    bump(s.cells[slot + bounds.size() + 1], 1);
+    atomic<uint64_t> &sum = s.cells[slot + bounds.size() + 2];
+    sum.store(asBits(asDouble(sum.load(memory_order_relaxed)) + value), memory_order_relaxed);
+}
+
+vector<double> latencyBuckets() {
+    return {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 10};
+}
+
+vector<double> countBuckets() {
+    return {10, 100, 1000, 10000, 100000, 1000000, 10000000};
+}
+
+string render() {
+    Registry &r = registry();
+    lock_guard<mutex> g(r.lock);
+
+    // Sum every slot over all shards; histogram sums are doubles
+    vector<uint64_t> total(r.used, 0);
+    vector<double> sums(r.used, 0.0);
+    for (const auto &shard : r.shards)
+        for (size_t i = 0; i < r.used; i++) {
+            uint64_t v = shard->cells[i].load(memory_order_relaxed);
+            total[i] += v;
+            sums[i] += asDouble(v);
+        }
+
+    // Series of one family must be adjacent, with HELP/TYPE once
+    map<string, vector<const Info *>> families;
+    for (const Info &info : r.infos) families[info.name].push_back(&info);
+
+    ostringstream out;
+    out.precision(10);
+    for (const auto &family : families) {
+        const Info &first = *family.second.front();
+        const char *type = first.kind == Kind::COUNTER ? "counter" : first.kind == Kind::GAUGE ? "gauge" : "histogram";
+        out << "# HELP " << family.first << " " << first.help << "\n";
+        out << "# TYPE " << family.first << " " << type << "\n";
+        for (const Info *info : family.second) {
+            if (info->kind == Kind::COUNTER) {
+                out << info->name << withLabels(info->labels) << " " << total[info->slot] << "\n";
+            } else if (info->kind == Kind::GAUGE) {
+                out << info->name << withLabels(info->labels) << " " << (int64_t)total[info->slot] << "\n";
+            } else {
+                uint64_t cumulative = 0;
+                for (size_t b = 0; b < info->bounds.size(); b++) {
+                    cumulative += total[info->slot + b];
+                    ostringstream le;
+                    le << "le=\"" << info->bounds[b] << "\"";
+                    out << info->name << "_bucket" << withLabels(info->labels, le.str()) << " " << cumulative << "\n";
+                }
+                size_t countSlot = info->slot + info->bounds.size() + 1;
+                out << info->name << "_bucket" << withLabels(info->labels, "le=\"+Inf\"") << " " << total[countSlot] << "\n";
+                out << info->name << "_sum" << withLabels(info->labels) << " " << sums[countSlot + 1] << "\n";
+                out << info->name << "_count" << withLabels(info->labels) << " " << total[countSlot] << "\n";
+            }
+        }
+    }
+    return out.str();
+}
+
+}
@@ -1,8 +1,7 @@
 #define _USE_MATH_DEFINES
 #include "Navigation.h"
+#include "Log.h"
 #include<cmath>
-#include<iostream>
-#include<fstream>
 
 using namespace std;
 
@@ -105,11 +104,8 @@ vector<Navinstruction> navigation::buildinstruction(Graph& g, const vector<long
         }
         
     }
-    ofstream file("practice/instruction.txt");
     for(auto& ins: instruction)
-        file<< ins.text<< "\n";
-
-    file.close();
+        LOG_DEBUG << ins.text << logging::kv("node", ins.node_id) << logging::kv("distance_m", ins.distance_m);
 
      return instruction;
     
@@ -0,0 +1,125 @@
+#include "OsmIngest.h"
+#include "OsmReader.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <atomic>
+
+namespace {
+
+double msSince(chrono::high_resolution_clock::time_point t){
+    chrono::duration<double, milli> d = chrono::high_resolution_clock::now() - t;
+    return d.count();
+}
+
+} // namespace
+
+bool ingestOSM(const string &filename, CSRGraph &out, IngestStats *stats, string *error, int threads){
+    IngestStats local;
+    IngestStats &st = stats ? *stats : local;
+    st = IngestStats();
+
+    OsmReader reader;
+    if (!reader.open(filename, error)) return false;
+    reader.setThreads(threads);
+
+    //-----Pass 1: road ways-----
+    auto t = chrono::high_resolution_clock::now();
+    vector<long long> refs;
+    vector<size_t> wayOffsets{0};
+    mutex wayLock;
+    bool ok = reader.readWays([&](const OsmWayBlock &b) {
+        lock_guard<mutex> lock(wayLock);
+        st.waysSeen += b.waysSeen;
+        st.roadWays += b.size();
+        refs.insert(refs.end(), b.refs.begin(), b.refs.end());
+        for (size_t i = 1; i < b.offsets.size(); i++)
+            wayOffsets.push_back(wayOffsets.back() + (b.offsets[i] - b.offsets[i - 1]));
+    }, error);
+    if (!ok) return false;
+
+    vector<long long> needed(refs);
+    parallelSort(needed.begin(), needed.end(), threads);
+    needed.erase(unique(needed.begin(), needed.end()), needed.end());
+    needed.shrink_to_fit();
+    st.wayPassMs = msSince(t);
+
+    //-----Pass 2: coordinates of road nodes-----
+    t = chrono::high_resolution_clock::now();
+    const double missing = numeric_limits<double>::quiet_NaN();
+    vector<double> lats(needed.size(), missing), lons(needed.size(), missing);
+    // Each needed id owns one slot, so blocks decoded on different
+    // threads never write the same element.
+    atomic<size_t> nodesSeen{0};
+    ok = reader.readNodes([&](const OsmNodeBlock &b) {
+        nodesSeen += b.size();
+        for (size_t i = 0; i < b.size(); i++) {
+            auto it = lower_bound(needed.begin(), needed.end(), b.ids[i]);
+            if (it == needed.end() || *it != b.ids[i]) continue;
+            size_t k = it - needed.begin();
+            lats[k] = b.lats[i];
+            lons[k] = b.lons[i];
+        }
+    }, error);
+    if (!ok) return false;
+    st.nodesSeen = nodesSeen;
+    st.nodePassMs = msSince(t);
+
+    //-----Edges between consecutive road nodes-----
+    t = chrono::high_resolution_clock::now();
+    // Refs whose node is missing from the extract (clipped at the border)
+    // are skipped and their neighbours joined, as the DOM parser did.
+    const size_t numWays = wayOffsets.size() - 1;
+    vector<vector<CSREdge>> parts(max(threads, 1));
+    int chunks = parallelChunks(numWays, threads, [&](int c, size_t wb, size_t we) {
+        vector<CSREdge> &part = parts[c];
+        for (size_t w = wb; w < we; w++) {
+            int32_t prev = -1;
+            for (size_t r = wayOffsets[w]; r < wayOffsets[w + 1]; r++) {
+                int32_t k = (int32_t)(lower_bound(needed.begin(), needed.end(), refs[r]) - needed.begin());
+                if (std::isnan(lats[k])) continue;
+                if (prev >= 0 && prev != k)
+                    part.push_back({prev, k, (float)CSRGraph::haversine(lats[prev], lons[prev], lats[k], lons[k])});
+                prev = k;
+            }
+        }
+    });
+    vector<size_t> partStart(chunks + 1, 0);
+    for (int c = 0; c < chunks; c++) partStart[c + 1] = partStart[c] + parts[c].size();
+    vector<CSREdge> edges(partStart[chunks]);
+    parallelChunks(chunks, chunks, [&](int, size_t cb, size_t ce) {
+        for (size_t c = cb; c < ce; c++) {
+            copy(parts[c].begin(), parts[c].end(), edges.begin() + partStart[c]);
+            vector<CSREdge>().swap(parts[c]);
+        }
+    });
+    vector<long long>().swap(refs);
+    st.edges = edges.size();
+
+    // Keep only nodes that carry an edge, renumbered in id order.
+    vector<int32_t> remap(needed.size(), -1);
+    for (const CSREdge &e : edges) remap[e.from] = remap[e.to] = 0;
+    vector<long long> ids;
+    vector<double> keptLats, keptLons;
+    for (size_t k = 0; k < needed.size(); k++) {
+        if (remap[k] < 0) continue;
+        remap[k] = (int32_t)ids.size();
+        ids.push_back(needed[k]);
+        keptLats.push_back(lats[k]);
+        keptLons.push_back(lons[k]);
+    }
+    parallelChunks(edges.size(), threads, [&](int, size_t b, size_t e) {
+        for (size_t i = b; i < e; i++) {
+            edges[i].from = remap[edges[i].from];
+            edges[i].to = remap[edges[i].to];
+        }
+    });
+    st.nodesKept = ids.size();
+
+    out.build(std::move(ids), std::move(keptLats), std::move(keptLons), edges, threads);
+    st.buildMs = msSince(t);
+    return true;
+}
@@ -0,0 +1,593 @@
+#include "OsmReader.h"
+#include "Parallel.h"
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <zlib.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// Blocks handed to the callbacks are flushed at roughly this many entries.
+const size_t BLOCK_ENTRIES = 1 << 16;
+const size_t XML_CHUNK_BYTES = 1 << 22;
+
+void setError(string *error, const string &msg){ if (error) *error = msg; }
+
+//---------------------XML------------------------------------------
+// One start or end tag. Pointers are into the scanner buffer and stay
+// valid until the next call to XmlScanner::next().
+struct XmlTag{
+    const char *name;
+    size_t nameLen;
+    const char *attrs;
+    const char *attrsEnd;
+    bool closing;
+    bool selfClosing;
+
+    bool is(const char *n, size_t len) const { return nameLen == len && memcmp(name, n, len) == 0; }
+
+    // Start of the value of attribute `key` (just after the opening quote).
+    const char *attr(const char *key, size_t keyLen) const{
+        const char *p = attrs;
+        while (p < attrsEnd) {
+            while (p < attrsEnd && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+            const char *k = p;
+            while (p < attrsEnd && *p != '=' && *p != ' ' && *p != '/') p++;
+            size_t kLen = p - k;
+            while (p < attrsEnd && (*p == '=' || *p == ' ')) p++;
+            if (p >= attrsEnd || (*p != '"' && *p != '\'')) return nullptr;
+            char quote = *p++;
+            const char *v = p;
+            while (p < attrsEnd && *p != quote) p++;
+            if (kLen == keyLen && memcmp(k, key, keyLen) == 0) return v;
+            p++;
+        }
+        return nullptr;
+    }
+};
+
+// Pull scanner over an XML file read in fixed-size chunks. It only
+// understands what OSM files contain: tags, comments, processing
+// instructions and a doctype; text content is skipped.
+class XmlScanner{
+public:
+    // Scans the markup that starts inside [begin, end) of the file.
+    XmlScanner(const string &filename, uint64_t begin, uint64_t end)
+        : in(filename, ios::binary), base(begin), limit(end) { in.seekg(begin); }
+    bool ok() const { return in.is_open(); }
+
+    bool next(XmlTag &t){
+        while (true) {
+            size_t open = buf.find('<', pos);
+            if (open != string::npos && base + open >= limit) return false;
+            if (open == string::npos) {
+                pos = buf.size();
+                if (!fill()) return false;
+                continue;
+            }
+            size_t end = findEnd(open);
+            if (end == string::npos) {
+                pos = open;
+                if (!fill()) return false; // truncated file
+                continue;
+            }
+            pos = end + 1;
+
+            const char *s = buf.data() + open + 1;
+            if (*s == '!' || *s == '?') continue;
+            t.closing = *s == '/';
+            if (t.closing) s++;
+            t.name = s;
+            const char *stop = buf.data() + end;
+            while (s < stop && *s != ' ' && *s != '/' && *s != '\t' && *s != '\n' && *s != '\r') s++;
+            t.nameLen = s - t.name;
+            t.selfClosing = end > open && buf[end - 1] == '/';
+            t.attrs = s;
+            t.attrsEnd = t.selfClosing ? stop - 1 : stop;
+            return true;
+        }
+    }
+
+private:
+    ifstream in;
+    string buf;
+    size_t pos = 0;
+    uint64_t base;  // file offset of buf[0]
+    uint64_t limit;
+
+    // Keeps the unconsumed tail and appends the next chunk.
+    bool fill(){
+        if (base + buf.size() >= limit && buf.find('<', pos) == string::npos) return false;
+        buf.erase(0, pos);
+        base += pos;
+        pos = 0;
+        size_t old = buf.size();
+        buf.resize(old + XML_CHUNK_BYTES);
+        in.read(&buf[old], XML_CHUNK_BYTES);
+        buf.resize(old + in.gcount());
+        return in.gcount() > 0;
+    }
+
+    // Index of the '>' closing the markup that starts at `open`; quoted
+    // attribute values may contain '>'.
+    size_t findEnd(size_t open) const{
+        if (buf.compare(open, 4, "<!--") == 0) {
+            size_t e = buf.find("-->", open + 4);
+            return e == string::npos ? e : e + 2;
+        }
+        char quote = 0;
+        for (size_t i = open + 1; i < buf.size(); i++) {
+            char c = buf[i];
+            if (quote) { if (c == quote) quote = 0; }
+            else if (c == '"' || c == '\'') quote = c;
+            else if (c == '>') return i;
+        }
+        return string::npos;
+    }
+};
+
+bool readXmlWays(const string &filename, uint64_t begin, uint64_t end,
+                 const function<void(const OsmWayBlock &)> &onBlock, string *error){
+    XmlScanner xml(filename, begin, end);
+    if (!xml.ok()) { setError(error, "cannot open " + filename); return false; }
+
+    OsmWayBlock block;
+    XmlTag t;
+    bool inWay = false, highway = false;
+    size_t wayStart = 0;
+    while (xml.next(t)) {
+        if (t.is("way", 3)) {
+            if (t.closing || t.selfClosing) {
+                if (inWay) {
+                    if (highway && block.refs.size() > wayStart) block.offsets.push_back((uint32_t)block.refs.size());
+                    else block.refs.resize(wayStart);
+                }
+                inWay = false;
+                block.waysSeen++;
+                if (block.refs.size() >= BLOCK_ENTRIES) { onBlock(block); block.clear(); }
+            } else {
+                inWay = true;
+                highway = false;
+                wayStart = block.refs.size();
+            }
+        } else if (inWay && !t.closing && t.is("nd", 2)) {
+            if (const char *ref = t.attr("ref", 3)) block.refs.push_back(strtoll(ref, nullptr, 10));
+        } else if (inWay && !t.closing && t.is("tag", 3)) {
+            const char *k = t.attr("k", 1);
+            if (k && strncmp(k, "highway", 7) == 0 && (k[7] == '"' || k[7] == '\'')) highway = true;
+        }
+    }
+    if (block.waysSeen) onBlock(block);
+    return true;
+}
+
+bool readXmlNodes(const string &filename, uint64_t begin, uint64_t end,
+                  const function<void(const OsmNodeBlock &)> &onBlock, string *error){
+    XmlScanner xml(filename, begin, end);
+    if (!xml.ok()) { setError(error, "cannot open " + filename); return false; }
+
+    OsmNodeBlock block;
+    XmlTag t;
+    while (xml.next(t)) {
+        if (t.closing || !t.is("node", 4)) continue;
+        const char *id = t.attr("id", 2), *lat = t.attr("lat", 3), *lon = t.attr("lon", 3);
+        if (!id || !lat || !lon) continue;
+        block.ids.push_back(strtoll(id, nullptr, 10));
+        block.lats.push_back(strtod(lat, nullptr));
+        block.lons.push_back(strtod(lon, nullptr));
+        if (block.size() >= BLOCK_ENTRIES) { onBlock(block); block.clear(); }
+    }
+    if (block.size()) onBlock(block);
+    return true;
+}
+
+//---------------------PBF------------------------------------------
+// Minimal protobuf wire-format reader, enough for the OSM PBF messages.
+struct Proto{
+    const uint8_t *p;
+    const uint8_t *end;
+    bool bad = false;
+
+    Proto(const uint8_t *b, const uint8_t *e) : p(b), end(e) {}
+    bool more() const { return !bad && p < end; }
+
+    uint64_t varint(){
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p >= end) { bad = true; return 0; }
+            uint8_t b = *p++;
+            v |= (uint64_t)(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        bad = true;
+        return v;
+    }
+    int64_t svarint(){
+        uint64_t v = varint();
+        return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+    }
+    void key(uint32_t &field, uint32_t &wire){
+        uint64_t k = varint();
+        field = (uint32_t)(k >> 3);
+        wire = (uint32_t)(k & 7);
+    }
+    Proto bytes(){
+        uint64_t len = varint();
+        if (bad || len > (uint64_t)(end - p)) { bad = true; return Proto(end, end); }
+        Proto sub(p, p + len);
+        p += len;
+        return sub;
+    }
+    void skip(uint32_t wire){
+        switch (wire) {
+            case 0: varint(); break;
+            case 1: if (end - p < 8) bad = true; else p += 8; break;
+            case 2: bytes(); break;
+            case 5: if (end - p < 4) bad = true; else p += 4; break;
+            default: bad = true;
+        }
+    }
+};
+
+// Reads the file blob by blob; inflating is left to the caller so it can
+// run on worker threads.
+class PbfFile{
+public:
+    explicit PbfFile(const string &filename) : in(filename, ios::binary) {}
+    bool ok() const { return in.is_open(); }
+
+    // Next raw OSMData blob. Returns false at the end of the file or on
+    // error (error is set only for the latter).
+    bool next(vector<uint8_t> &blob, string *error){
+        while (true) {
+            uint8_t lenBytes[4];
+            if (!in.read(reinterpret_cast<char*>(lenBytes), 4)) return false;
+            uint32_t headerLen = (uint32_t)lenBytes[0] << 24 | (uint32_t)lenBytes[1] << 16 |
+                                 (uint32_t)lenBytes[2] << 8 | lenBytes[3];
+            if (headerLen > 64 * 1024) { setError(error, "corrupt blob header"); return false; }
+            header.resize(headerLen);
+            if (!in.read(reinterpret_cast<char*>(header.data()), headerLen)) { setError(error, "truncated blob header"); return false; }
+
+            string type;
+            uint64_t dataSize = 0;
+            Proto h(header.data(), header.data() + header.size());
+            while (h.more()) {
+                uint32_t f, w;
+                h.key(f, w);
+                if (f == 1 && w == 2) { Proto s = h.bytes(); type.assign((const char*)s.p, s.end - s.p); }
+                else if (f == 3 && w == 0) dataSize = h.varint();
+                else h.skip(w);
+            }
+            if (h.bad || dataSize > 64 * 1024 * 1024) { setError(error, "corrupt blob header"); return false; }
+
+            blob.resize(dataSize);
+            if (!in.read(reinterpret_cast<char*>(blob.data()), dataSize)) { setError(error, "truncated blob"); return false; }
+            if (type == "OSMData") return true; // OSMHeader carries nothing we need
+        }
+    }
+
+    static bool inflateBlob(const vector<uint8_t> &blob, vector<uint8_t> &out, string *error){
+        Proto b(blob.data(), blob.data() + blob.size());
+        Proto raw(nullptr, nullptr), zdata(nullptr, nullptr);
+        uint64_t rawSize = 0;
+        bool haveRaw = false, haveZlib = false;
+        while (b.more()) {
+            uint32_t f, w;
+            b.key(f, w);
+            if (f == 1 && w == 2) { raw = b.bytes(); haveRaw = true; }
+            else if (f == 2 && w == 0) rawSize = b.varint();
+            else if (f == 3 && w == 2) { zdata = b.bytes(); haveZlib = true; }
+            else if (f >= 4 && f <= 7) { setError(error, "unsupported blob compression"); return false; }
+            else b.skip(w);
+        }
+        if (b.bad) { setError(error, "corrupt blob"); return false; }
+        if (haveRaw) {
+            out.assign(raw.p, raw.end);
+            return true;
+        }
+        if (!haveZlib || rawSize > 64 * 1024 * 1024) { setError(error, "corrupt blob"); return false; }
+        out.resize(rawSize);
+        uLongf outLen = (uLongf)rawSize;
+        if (uncompress(out.data(), &outLen, zdata.p, (uLong)(zdata.end - zdata.p)) != Z_OK || outLen != rawSize) {
+            setError(error, "zlib error in blob");
+            return false;
+        }
+        return true;
+    }
+
+private:
+    ifstream in;
+    vector<uint8_t> header;
+};
+
+// Splits a PrimitiveBlock into its string table and primitive groups.
+struct PrimitiveBlock{
+    vector<pair<const uint8_t*, size_t>> strings;
+    vector<Proto> groups;
+    int64_t granularity = 100;
+    int64_t latOffset = 0;
+    int64_t lonOffset = 0;
+
+    bool parse(const vector<uint8_t> &data){
+        Proto b(data.data(), data.data() + data.size());
+        while (b.more()) {
+            uint32_t f, w;
+            b.key(f, w);
+            if (f == 1 && w == 2) {
+                Proto st = b.bytes();
+                while (st.more()) {
+                    uint32_t sf, sw;
+                    st.key(sf, sw);
+                    if (sf == 1 && sw == 2) { Proto s = st.bytes(); strings.push_back({s.p, (size_t)(s.end - s.p)}); }
+                    else st.skip(sw);
+                }
+                if (st.bad) return false;
+            }
+            else if (f == 2 && w == 2) groups.push_back(b.bytes());
+            else if (f == 17 && w == 0) granularity = (int64_t)b.varint();
+            else if (f == 19 && w == 0) latOffset = (int64_t)b.varint();
+            else if (f == 20 && w == 0) lonOffset = (int64_t)b.varint();
+            else b.skip(w);
+        }
+        return !b.bad;
+    }
+
+    int64_t stringIndex(const char *s) const{
+        size_t len = strlen(s);
+        for (size_t i = 0; i < strings.size(); i++)
+            if (strings[i].second == len && memcmp(strings[i].first, s, len) == 0) return (int64_t)i;
+        return -1;
+    }
+
+    double lat(int64_t v) const { return 1e-9 * (latOffset + granularity * v); }
+    double lon(int64_t v) const { return 1e-9 * (lonOffset + granularity * v); }
+};
+
+bool decodeWays(const vector<uint8_t> &data, OsmWayBlock &block){
+    PrimitiveBlock pb;
+    if (!pb.parse(data)) return false;
+    const int64_t highway = pb.stringIndex("highway");
+
+    for (Proto g : pb.groups) {
+        while (g.more()) {
+            uint32_t f, w;
+            g.key(f, w);
+            if (f != 3 || w != 2) { g.skip(w); continue; }
+
+            Proto way = g.bytes();
+            block.waysSeen++;
+            bool isRoad = false;
+            size_t wayStart = block.refs.size();
+            while (way.more()) {
+                uint32_t wf, ww;
+                way.key(wf, ww);
+                if (wf == 2 && ww == 2) {
+                    Proto keys = way.bytes();
+                    while (keys.more()) if ((int64_t)keys.varint() == highway) isRoad = true;
+                } else if (wf == 8 && ww == 2) {
+                    Proto refs = way.bytes();
+                    int64_t ref = 0;
+                    while (refs.more()) {
+                        ref += refs.svarint();
+                        block.refs.push_back(ref);
+                    }
+                } else way.skip(ww);
+            }
+            if (way.bad) return false;
+            if (isRoad && block.refs.size() > wayStart) block.offsets.push_back((uint32_t)block.refs.size());
+            else block.refs.resize(wayStart);
+        }
+        if (g.bad) return false;
+    }
+    return true;
+}
+
+bool decodeNodes(const vector<uint8_t> &data, OsmNodeBlock &block){
+    PrimitiveBlock pb;
+    if (!pb.parse(data)) return false;
+
+    for (Proto g : pb.groups) {
+        while (g.more()) {
+            uint32_t f, w;
+            g.key(f, w);
+            if (f == 1 && w == 2) {
+                Proto node = g.bytes();
+                int64_t id = 0, lat = 0, lon = 0;
+                while (node.more()) {
+                    uint32_t nf, nw;
+                    node.key(nf, nw);
+                    if (nf == 1 && nw == 0) id = node.svarint();
+                    else if (nf == 8 && nw == 0) lat = node.svarint();
+                    else if (nf == 9 && nw == 0) lon = node.svarint();
+                    else node.skip(nw);
+                }
+                if (node.bad) return false;
+                block.ids.push_back(id);
+                block.lats.push_back(pb.lat(lat));
+                block.lons.push_back(pb.lon(lon));
+            } else if (f == 2 && w == 2) {
+                // DenseNodes: parallel delta-coded id/lat/lon arrays
+                Proto dense = g.bytes();
+                Proto ids(nullptr, nullptr), lats(nullptr, nullptr), lons(nullptr, nullptr);
+                while (dense.more()) {
+                    uint32_t df, dw;
+                    dense.key(df, dw);
+                    if (df == 1 && dw == 2) ids = dense.bytes();
+                    else if (df == 8 && dw == 2) lats = dense.bytes();
+                    else if (df == 9 && dw == 2) lons = dense.bytes();
+                    else dense.skip(dw);
+                }
+                if (dense.bad) return false;
+                int64_t id = 0, lat = 0, lon = 0;
+                while (ids.more() && lats.more() && lons.more()) {
+                    id += ids.svarint();
+                    lat += lats.svarint();
+                    lon += lons.svarint();
+                    block.ids.push_back(id);
+                    block.lats.push_back(pb.lat(lat));
+                    block.lons.push_back(pb.lon(lon));
+                }
+                if (ids.bad || lats.bad || lons.bad) return false;
+            } else g.skip(w);
+        }
+        if (g.bad) return false;
+    }
+    return true;
+}
+
+//---------------------Parallel drivers-----------------------------
+// One thread reads raw blobs into a bounded queue; `threads` workers
+// inflate and decode them and hand each decoded block to onBlock.
+template<typename Block, typename Decode>
+bool readPbf(const string &filename, int threads, Decode decode,
+             const function<void(const Block &)> &onBlock, string *error){
+    PbfFile pbf(filename);
+    if (!pbf.ok()) { setError(error, "cannot open " + filename); return false; }
+
+    mutex m;
+    condition_variable cv;
+    deque<vector<uint8_t>> queue;
+    const size_t capacity = 2 * (size_t)threads;
+    bool done = false, failed = false;
+    string firstError;
+
+    auto fail = [&](const string &msg) {
+        lock_guard<mutex> lock(m);
+        if (!failed) firstError = msg;
+        failed = true;
+        cv.notify_all();
+    };
+
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&]() {
+            vector<uint8_t> blob, data;
+            Block block;
+            string err;
+            while (true) {
+                {
+                    unique_lock<mutex> lock(m);
+                    cv.wait(lock, [&]() { return !queue.empty() || done || failed; });
+                    if (failed || queue.empty()) return;
+                    blob.swap(queue.front());
+                    queue.pop_front();
+                    cv.notify_all();
+                }
+                block.clear();
+                if (!PbfFile::inflateBlob(blob, data, &err)) { fail(err); return; }
+                if (!decode(data, block)) { fail("corrupt PrimitiveBlock"); return; }
+                onBlock(block);
+            }
+        });
+    }
+
+    vector<uint8_t> blob;
+    string err;
+    while (pbf.next(blob, &err)) {
+        unique_lock<mutex> lock(m);
+        cv.wait(lock, [&]() { return queue.size() < capacity || failed; });
+        if (failed) break;
+        queue.push_back(std::move(blob));
+        blob = vector<uint8_t>();
+        cv.notify_all();
+    }
+    if (!err.empty()) fail(err);
+    {
+        lock_guard<mutex> lock(m);
+        done = true;
+        cv.notify_all();
+    }
+    for (auto &w : workers) w.join();
+
+    if (failed) { setError(error, firstError); return false; }
+    return true;
+}
+
+// Splits an XML file into byte ranges that each start at a top-level
+// <node or <way element, so no element straddles two ranges.
+vector<uint64_t> xmlRanges(const string &filename, int parts){
+    ifstream in(filename, ios::binary | ios::ate);
+    const uint64_t size = in.is_open() ? (uint64_t)in.tellg() : 0;
+    vector<uint64_t> bounds{0};
+    string window;
+    for (int p = 1; p < parts; p++) {
+        uint64_t at = max(bounds.back(), size * p / parts);
+        uint64_t found = size;
+        while (at < size) {
+            window.resize(min<uint64_t>(XML_CHUNK_BYTES, size - at));
+            in.seekg(at);
+            in.read(&window[0], window.size());
+            window.resize(in.gcount());
+            if (window.empty()) break;
+            size_t hit = string::npos;
+            for (const char *tag : {"<node ", "<way "}) hit = min(hit, window.find(tag));
+            if (hit != string::npos) { found = at + hit; break; }
+            if (window.size() < 8) break;
+            at += window.size() - 6; // a tag may straddle two windows
+        }
+        bounds.push_back(found);
+    }
+    bounds.push_back(size);
+    return bounds;
+}
+
+template<typename Block>
+bool readXml(const string &filename, int threads,
+             bool (*scan)(const string &, uint64_t, uint64_t, const function<void(const Block &)> &, string *),
+             const function<void(const Block &)> &onBlock, string *error){
+    vector<uint64_t> bounds = xmlRanges(filename, threads);
+    vector<string> errors(bounds.size() - 1);
+    vector<char> ok(bounds.size() - 1, 1);
+    parallelChunks(bounds.size() - 1, (int)bounds.size() - 1, [&](int, size_t b, size_t e) {
+        for (size_t r = b; r < e; r++)
+            if (bounds[r] < bounds[r + 1])
+                ok[r] = scan(filename, bounds[r], bounds[r + 1], onBlock, &errors[r]);
+    });
+    for (size_t r = 0; r < ok.size(); r++)
+        if (!ok[r]) { setError(error, errors[r]); return false; }
+    return true;
+}
+
+} // namespace
+
+//---------------------OsmReader------------------------------------
+bool OsmReader::open(const string &file, string *error){
+    filename = file;
+    ifstream in(filename, ios::binary);
+    if (!in.is_open()) {
+        setError(error, "cannot open " + filename);
+        return false;
+    }
+    char head[16] = {0};
+    in.read(head, sizeof(head));
+    size_t got = (size_t)in.gcount();
+
+    // A PBF file starts with a BlobHeader whose type is "OSMHeader".
+    if (got >= 15 && head[4] == 0x0A && head[5] == 9 && memcmp(head + 6, "OSMHeader", 9) == 0) {
+        fmt = PBF;
+        return true;
+    }
+    size_t i = 0;
+    if (got >= 3 && (unsigned char)head[0] == 0xEF && (unsigned char)head[1] == 0xBB && (unsigned char)head[2] == 0xBF) i = 3;
+    while (i < got && (head[i] == ' ' || head[i] == '\n' || head[i] == '\r' || head[i] == '\t')) i++;
+    if (i < got && head[i] == '<') {
+        fmt = XML;
+        return true;
+    }
+    setError(error, filename + " is neither OSM XML nor OSM PBF (compressed .osm files must be unpacked first)");
+    return false;
+}
+
+bool OsmReader::readWays(const function<void(const OsmWayBlock &)> &onBlock, string *error){
+    if (fmt == XML) return readXml<OsmWayBlock>(filename, threads, readXmlWays, onBlock, error);
+    return readPbf<OsmWayBlock>(filename, threads, decodeWays, onBlock, error);
+}
+
+bool OsmReader::readNodes(const function<void(const OsmNodeBlock &)> &onBlock, string *error){
+    if (fmt == XML) return readXml<OsmNodeBlock>(filename, threads, readXmlNodes, onBlock, error);
+    return readPbf<OsmNodeBlock>(filename, threads, decodeNodes, onBlock, error);
+}
@@ -0,0 +1,122 @@
+#include "RouteCache.h"
+#include <cstring>
+#include <functional>
+
+RouteCache::RouteCache(size_t maxBytes, int shardCount){
+    shardCount = max(1, shardCount);
+    for (int i = 0; i < shardCount; i++) shards.emplace_back(new Shard());
+    shardBudget = maxBytes / shardCount;
+}
+
+string RouteCache::key(const string &mode, const vector<SearchEndpoint> &sources,
+                       const vector<SearchEndpoint> &targets){
+    // Raw bytes of every seed; exact equality is what makes a hit safe
+    string k = mode;
+    k.push_back('\0');
+    auto append = [&](const vector<SearchEndpoint> &seeds) {
+        uint32_t n = (uint32_t)seeds.size();
+        k.append(reinterpret_cast<const char *>(&n), sizeof(n));
+        for (const SearchEndpoint &e : seeds) {
+            k.append(reinterpret_cast<const char *>(&e.node), sizeof(e.node));
+            k.append(reinterpret_cast<const char *>(&e.cost), sizeof(e.cost));
+            k.append(reinterpret_cast<const char *>(&e.offset), sizeof(e.offset));
+        }
+    };
+    append(sources);
+    append(targets);
+    return k;
+}
+
+RouteCache::Shard &RouteCache::shardFor(const string &key){
+    size_t h = hash<string>()(key);
+    // The map inside the shard uses the low bits; pick the shard with the high ones
+    return *shards[(h >> 32 ^ h >> 16) % shards.size()];
+}
+
+size_t RouteCache::sizeOf(const string &key, const PathResult &r){
+    // Entry, list node, map node and key twice, plus the path vectors
+    return sizeof(Entry) + sizeof(PathResult) + 64 + 2 * key.capacity()
+         + r.nodes.capacity() * sizeof(long long) + r.coordinates.capacity() * sizeof(PathPoint);
+}
+
+void RouteCache::eraseLocked(Shard &s, list<Entry>::iterator it){
+    s.bytes -= it->bytes;
+    byteCount.add(-(int64_t)it->bytes);
+    entryCount.dec();
+    s.index.erase(it->key);
+    s.lru.erase(it);
+}
+
+shared_ptr<const PathResult> RouteCache::get(const string &key){
+    if (!enabled()) return nullptr;
+    Shard &s = shardFor(key);
+    lock_guard<mutex> g(s.lock);
+    auto it = s.index.find(key);
+    if (it == s.index.end()) {
+        misses.inc();
+        return nullptr;
+    }
+    if (it->second->epoch != epoch.load(memory_order_acquire)) {
+        eraseLocked(s, it->second);
+        misses.inc();
+        return nullptr;
+    }
+    s.lru.splice(s.lru.begin(), s.lru, it->second);
+    hits.inc();
+    return it->second->value;
+}
+
+void RouteCache::put(const string &key, const PathResult &result, uint64_t computedAt){
+    if (!enabled()) return;
+    const size_t bytes = sizeOf(key, result);
+    if (bytes > shardBudget) return;
+    if (computedAt != epochNow()) return;
+    auto value = make_shared<const PathResult>(result);
+
+    Shard &s = shardFor(key);
+    lock_guard<mutex> g(s.lock);
+    auto it = s.index.find(key);
+    if (it != s.index.end()) eraseLocked(s, it->second);
+    while (!s.lru.empty() && s.bytes + bytes > shardBudget) {
+        eraseLocked(s, prev(s.lru.end()));
+        evictions.inc();
+    }
+    s.lru.push_front({key, std::move(value), bytes, computedAt});
+    s.index[key] = s.lru.begin();
+    s.bytes += bytes;
+    byteCount.add((int64_t)bytes);
+    entryCount.inc();
+}
+
+void RouteCache::bindGraph(uint64_t fingerprint){
+    lock_guard<mutex> g(bindLock);
+    if (fingerprint == graphFingerprint) return;
+    graphFingerprint = fingerprint;
+    invalidate();
+}
+
+void RouteCache::invalidate(){
+    epoch.fetch_add(1, memory_order_acq_rel);
+    for (auto &shard : shards) {
+        lock_guard<mutex> g(shard->lock);
+        while (!shard->lru.empty()) eraseLocked(*shard, shard->lru.begin());
+    }
+}
+
+size_t RouteCache::entries() const{
+    size_t n = 0;
+    for (const auto &shard : shards) {
+        lock_guard<mutex> g(shard->lock);
+        n += shard->lru.size();
+    }
+    return n;
+}
+
+size_t RouteCache::bytes() const{
+    size_t n = 0;
+    for (const auto &shard : shards) {
+        lock_guard<mutex> g(shard->lock);
+        n += shard->bytes;
+    }
+    return n;
+}
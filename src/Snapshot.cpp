@@ -0,0 +1,252 @@
+#include "Snapshot.h"
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = {'M', 'M', 'G', 'R', 'A', 'P', 'H', '\0'};
+const size_t HEADER_BYTES = 256;
+const size_t SECTION_ALIGN = 64;
+
+enum Section { IDS, LATS, LONS, OFFSETS, TARGETS, WEIGHTS, BY_ID, COMPONENTS, COMPONENT_SIZES, KD_ORDER, SECTION_COUNT };
+
+struct SectionEntry{
+    uint64_t offset; // from the start of the file
+    uint64_t bytes;
+};
+
+struct Header{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerBytes;
+    int32_t numNodes;
+    int32_t numComponents;
+    int32_t largestComponent;
+    uint32_t reserved;
+    uint64_t numEdges;
+    uint64_t fingerprint;
+    uint64_t checksum;      // over [HEADER_BYTES, HEADER_BYTES + payloadBytes)
+    uint64_t payloadBytes;
+    SectionEntry sections[SECTION_COUNT];
+};
+static_assert(sizeof(Header) <= HEADER_BYTES, "snapshot header too large");
+
+// Word-at-a-time hash; the payload is always a multiple of 8 bytes.
+uint64_t checksum(const unsigned char *data, size_t bytes){
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ bytes;
+    for (size_t i = 0; i + 8 <= bytes; i += 8) {
+        uint64_t w;
+        memcpy(&w, data + i, 8);
+        h = ((h << 5) | (h >> 59)) ^ w;
+        h *= 0x9E3779B97F4A7C15ULL;
+    }
+    return h;
+}
+
+size_t alignUp(size_t x){ return (x + SECTION_ALIGN - 1) / SECTION_ALIGN * SECTION_ALIGN; }
+
+void setError(string *error, const string &msg){ if (error) *error = msg; }
+
+// Read-only view of a whole file, unmapped when the last user goes away.
+struct MappedFile{
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    vector<unsigned char> buffer; // no mmap: read the file instead
+#endif
+
+    ~MappedFile(){
+#ifndef _WIN32
+        if (data) munmap(const_cast<unsigned char*>(data), size);
+#endif
+    }
+
+    bool open(const string &filename){
+#ifdef _WIN32
+        ifstream in(filename, ios::binary);
+        if (!in.is_open()) return false;
+        buffer.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        data = buffer.data();
+        size = buffer.size();
+        return true;
+#else
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) { ::close(fd); return false; }
+        void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        data = static_cast<const unsigned char*>(p);
+        size = (size_t)st.st_size;
+        return true;
+#endif
+    }
+};
+
+} // namespace
+
+bool snapshot::write(const string &filename, const CSRGraph &g, const vector<int32_t> &kdOrder, string *error){
+    const CSRArrays &a = g.arrays();
+    const size_t N = a.numNodes, M = a.numEdges;
+    if (kdOrder.size() != N) {
+        setError(error, "KD-tree order does not match the node count");
+        return false;
+    }
+
+    const void *data[SECTION_COUNT] = {a.ids, a.lats, a.lons, a.offsets, a.targets, a.weights,
+                                       a.byId, a.components, a.componentSizes, kdOrder.data()};
+    const size_t bytes[SECTION_COUNT] = {N * sizeof(long long), N * sizeof(double), N * sizeof(double),
+                                         (N + 1) * sizeof(uint32_t), M * sizeof(int32_t), M * sizeof(float),
+                                         N * sizeof(int32_t), N * sizeof(int32_t),
+                                         a.numComponents * sizeof(int32_t), N * sizeof(int32_t)};
+
+    Header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAPSHOT_MAGIC, 8);
+    h.version = VERSION;
+    h.headerBytes = HEADER_BYTES;
+    h.numNodes = a.numNodes;
+    h.numComponents = a.numComponents;
+    h.largestComponent = a.largestComponent;
+    h.numEdges = M;
+    h.fingerprint = g.fingerprint();
+
+    // Lay the sections out in one buffer so the checksum is a single pass.
+    size_t pos = HEADER_BYTES;
+    for (int s = 0; s < SECTION_COUNT; s++) {
+        h.sections[s].offset = pos;
+        h.sections[s].bytes = bytes[s];
+        pos = alignUp(pos + bytes[s]);
+    }
+    vector<unsigned char> payload(pos - HEADER_BYTES, 0);
+    for (int s = 0; s < SECTION_COUNT; s++)
+        if (bytes[s]) memcpy(&payload[h.sections[s].offset - HEADER_BYTES], data[s], bytes[s]);
+    h.payloadBytes = payload.size();
+    h.checksum = checksum(payload.data(), payload.size());
+
+    // A running server maps the current file, so it is never rewritten in
+    // place: the new snapshot goes to a temporary file that replaces the
+    // old name only once it is complete and on disk.
+    const string tmp = filename + ".tmp";
+    ofstream out(tmp, ios::binary | ios::trunc);
+    if (!out.is_open()) {
+        setError(error, "cannot open " + tmp + " for writing");
+        return false;
+    }
+    char header[HEADER_BYTES] = {0};
+    memcpy(header, &h, sizeof(h));
+    out.write(header, HEADER_BYTES);
+    out.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+    out.close();
+    if (!out) {
+        setError(error, "write to " + tmp + " failed");
+        remove(tmp.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    remove(filename.c_str());
+#else
+    int fd = ::open(tmp.c_str(), O_RDONLY);
+    bool synced = fd >= 0 && ::fsync(fd) == 0;
+    if (fd >= 0) ::close(fd);
+    if (!synced) {
+        setError(error, "fsync of " + tmp + " failed");
+        remove(tmp.c_str());
+        return false;
+    }
+#endif
+    if (rename(tmp.c_str(), filename.c_str()) != 0) {
+        setError(error, "cannot rename " + tmp + " to " + filename);
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool snapshot::load(const string &filename, CSRGraph &g, vector<int32_t> &kdOrder, bool verifyChecksum, string *error){
+    auto file = make_shared<MappedFile>();
+    if (!file->open(filename)) {
+        setError(error, "cannot map " + filename);
+        return false;
+    }
+    if (file->size < HEADER_BYTES) {
+        setError(error, "file too small");
+        return false;
+    }
+
+    Header h;
+    memcpy(&h, file->data, sizeof(h));
+    if (memcmp(h.magic, SNAPSHOT_MAGIC, 8) != 0) {
+        setError(error, "not a graph snapshot");
+        return false;
+    }
+    if (h.version != VERSION || h.headerBytes != HEADER_BYTES) {
+        setError(error, "unsupported snapshot version " + to_string(h.version));
+        return false;
+    }
+    if (h.numNodes < 0 || h.numComponents < 0 || HEADER_BYTES + h.payloadBytes > file->size) {
+        setError(error, "truncated snapshot");
+        return false;
+    }
+
+    const size_t N = h.numNodes, M = h.numEdges;
+    const size_t expected[SECTION_COUNT] = {N * sizeof(long long), N * sizeof(double), N * sizeof(double),
+                                            (N + 1) * sizeof(uint32_t), M * sizeof(int32_t), M * sizeof(float),
+                                            N * sizeof(int32_t), N * sizeof(int32_t),
+                                            h.numComponents * sizeof(int32_t), N * sizeof(int32_t)};
+    for (int s = 0; s < SECTION_COUNT; s++) {
+        const SectionEntry &e = h.sections[s];
+        if (e.bytes != expected[s] || e.offset % SECTION_ALIGN != 0 || e.offset + e.bytes > file->size) {
+            setError(error, "corrupt section table");
+            return false;
+        }
+    }
+
+    if (verifyChecksum && checksum(file->data + HEADER_BYTES, h.payloadBytes) != h.checksum) {
+        setError(error, "checksum mismatch");
+        return false;
+    }
+
+    auto at = [&](Section s) { return file->data + h.sections[s].offset; };
+    CSRArrays view;
+    view.numNodes = h.numNodes;
+    view.numEdges = h.numEdges;
+    view.numComponents = h.numComponents;
+    view.largestComponent = h.largestComponent;
+    view.ids = reinterpret_cast<const long long*>(at(IDS));
+    view.lats = reinterpret_cast<const double*>(at(LATS));
+    view.lons = reinterpret_cast<const double*>(at(LONS));
+    view.offsets = reinterpret_cast<const uint32_t*>(at(OFFSETS));
+    view.targets = reinterpret_cast<const int32_t*>(at(TARGETS));
+    view.weights = reinterpret_cast<const float*>(at(WEIGHTS));
+    view.byId = reinterpret_cast<const int32_t*>(at(BY_ID));
+    view.components = reinterpret_cast<const int32_t*>(at(COMPONENTS));
+    view.componentSizes = reinterpret_cast<const int32_t*>(at(COMPONENT_SIZES));
+
+    // The fingerprint ties the file to the CSR it was written from; a
+    // mismatch means the payload or the hash definition has changed since.
+    // Once verified it stays on the graph, so later users never rehash.
+    view.fingerprint = h.fingerprint;
+    CSRGraph loaded;
+    loaded.attach(view, file);
+    if (loaded.computeFingerprint() != h.fingerprint) {
+        setError(error, "graph fingerprint mismatch");
+        return false;
+    }
+    g = std::move(loaded);
+
+    const int32_t *kd = reinterpret_cast<const int32_t*>(at(KD_ORDER));
+    kdOrder.assign(kd, kd + N);
+    return true;
+}
@@ -0,0 +1,121 @@
+#include "Tour.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <cstdint>
+
+namespace {
+
+// Moves shorter than this are rounding noise and would let the search cycle
+const double EPS = 1e-7;
+
+} // namespace
+
+TourResult solveTour(const vector<double> &matrix, size_t n, const TourOptions &options){
+    TourResult result;
+    if (n == 0) return result;
+    auto d = [&](int a, int b) { return matrix[(size_t)a * n + b]; };
+    const int end = options.roundTrip ? 0 : (int)n - 1;
+    if (n == 1) {
+        result.order = options.roundTrip ? vector<int>{0, 0} : vector<int>{0};
+        return result;
+    }
+
+    //-----Nearest insertion-----
+    // Repeatedly take the stop closest to any stop already in the tour and
+    // put it where it lengthens the tour least.
+    vector<int> tour{0, end};
+    vector<uint8_t> inTour(n, 0);
+    inTour[0] = inTour[end] = 1;
+    vector<double> closest(n, numeric_limits<double>::infinity());
+    for (size_t v = 0; v < n; v++) closest[v] = min(d(0, v), d(end, v));
+    for (;;) {
+        int next = -1;
+        for (size_t v = 0; v < n; v++)
+            if (!inTour[v] && (next < 0 || closest[v] < closest[next])) next = (int)v;
+        if (next < 0) break;
+
+        size_t bestPos = 1;
+        double bestDelta = numeric_limits<double>::infinity();
+        for (size_t i = 0; i + 1 < tour.size(); i++) {
+            double delta = d(tour[i], next) + d(next, tour[i + 1]) - d(tour[i], tour[i + 1]);
+            if (delta < bestDelta) {
+                bestDelta = delta;
+                bestPos = i + 1;
+            }
+        }
+        tour.insert(tour.begin() + bestPos, next);
+        inTour[next] = 1;
+        for (size_t v = 0; v < n; v++) closest[v] = min(closest[v], d(next, v));
+    }
+
+    auto tourCost = [&]() {
+        double c = 0.0;
+        for (size_t i = 0; i + 1 < tour.size(); i++) c += d(tour[i], tour[i + 1]);
+        return c;
+    };
+    result.initialCost = tourCost();
+
+    //-----Local search-----
+    // Positions 1 .. m-2 are movable; the first and last stay put.
+    const auto startTime = chrono::steady_clock::now();
+    auto outOfTime = [&]() {
+        chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - startTime;
+        return elapsed.count() > options.timeLimitMs;
+    };
+    const int m = (int)tour.size();
+    bool improved = true;
+    while (improved && !result.timedOut) {
+        improved = false;
+
+        // 2-opt: reverse tour[i..j], replacing edges (i-1,i) and (j,j+1)
+        for (int i = 1; i < m - 2 && !result.timedOut; i++) {
+            for (int j = i + 1; j < m - 1; j++) {
+                double delta = d(tour[i - 1], tour[j]) + d(tour[i], tour[j + 1])
+                             - d(tour[i - 1], tour[i]) - d(tour[j], tour[j + 1]);
+                if (delta < -EPS) {
+                    reverse(tour.begin() + i, tour.begin() + j + 1);
+                    result.improvements++;
+                    improved = true;
+                }
+            }
+            result.timedOut = outOfTime();
+        }
+
+        // Or-opt: move a run of 1-3 stops between two other neighbours,
+        // either way round
+        for (int len = 1; len <= 3 && !result.timedOut; len++) {
+            for (int i = 1; i + len < m && !result.timedOut; i++) {
+                const int first = tour[i], last = tour[i + len - 1];
+                const int prev = tour[i - 1], after = tour[i + len];
+                const double removeGain = d(prev, first) + d(last, after) - d(prev, after);
+
+                int bestP = -1;
+                bool bestReversed = false;
+                double bestDelta = -EPS;
+                for (int p = 0; p + 1 < m; p++) {
+                    if (p >= i - 1 && p < i + len) continue; // an edge touching the run
+                    const int a = tour[p], b = tour[p + 1];
+                    double forward = d(a, first) + d(last, b) - d(a, b) - removeGain;
+                    double backward = d(a, last) + d(first, b) - d(a, b) - removeGain;
+                    if (forward < bestDelta) { bestDelta = forward; bestP = p; bestReversed = false; }
+                    if (backward < bestDelta) { bestDelta = backward; bestP = p; bestReversed = true; }
+                }
+                if (bestP >= 0) {
+                    vector<int> run(tour.begin() + i, tour.begin() + i + len);
+                    if (bestReversed) reverse(run.begin(), run.end());
+                    tour.erase(tour.begin() + i, tour.begin() + i + len);
+                    const int at = bestP < i ? bestP + 1 : bestP + 1 - len;
+                    tour.insert(tour.begin() + at, run.begin(), run.end());
+                    result.improvements++;
+                    improved = true;
+                }
+                result.timedOut = outOfTime();
+            }
+        }
+    }
+
+    result.cost = tourCost();
+    result.order = std::move(tour);
+    return result;
+}
@@ -1,4 +1,5 @@
 #include "kdtree.h"
+#include "SpatialBatch.h"
 #define _USE_MATH_DEFINES
 #include <cmath>
 #ifndef M_PI
@@ -7,39 +8,67 @@
 
 
 void KDTree::build(const std::vector<KDPoint> &points) {
-    pts_copy = points;
-    if (pts_copy.empty()) { deleteAll(root); root = nullptr; return; }
+    std::vector<KDPoint> pts(points);
+    layout(pts, false);
+}
 
-    double sumLat = 0.0;
-    for (auto &p : pts_copy) sumLat += p.lat;
-    ref_lat_deg = sumLat / pts_copy.size();
+void KDTree::buildInOrder(const std::vector<KDPoint> &points) {
+    std::vector<KDPoint> pts(points);
+    layout(pts, true);
+}
+
+void KDTree::layout(std::vector<KDPoint> &pts, bool presorted) {
+    xs.clear();
+    ys.clear();
+    ids.clear();
+    flags.clear();
+    splits.clear();
+    depth = 0;
+    if (pts.empty()) return;
 
-    for (auto &p : pts_copy)
+    double sumLat = 0.0;
+    for (auto &p : pts) sumLat += p.lat;
+    ref_lat_deg = sumLat / pts.size();
+    for (auto &p : pts)
         projectLatLonToMeters(p.lat, p.lon, ref_lat_deg, p.x, p.y);
 
-    deleteAll(root);
-    root = buildRec(0, int(pts_copy.size()) - 1, 0);
+    // Halve until the largest range fits in a leaf bucket; ranges on one
+    // level differ by at most one point, so every leaf holds 16-32 points.
+    const size_t n = pts.size();
+    while (((n + (size_t(1) << depth) - 1) >> depth) > (size_t)LEAF_SIZE) depth++;
+    splits.assign((size_t(1) << depth) - 1, 0.0);
+    buildRec(pts, 0, 0, n, 0, presorted);
+
+    xs.reserve(n);
+    ys.reserve(n);
+    ids.reserve(n);
+    for (const auto &p : pts) {
+        xs.push_back(p.x);
+        ys.push_back(p.y);
+        ids.push_back(p.id);
+    }
 }
 
-KDNode* KDTree::buildRec(int l, int r, int depth) {
-    if (l > r) return nullptr;
-    int axis = depth % 2;
-    int mid = (l + r) / 2;
+void KDTree::buildRec(std::vector<KDPoint> &pts, size_t node, size_t l, size_t r, int level, bool presorted) {
+    if (level == depth) return;
+    int axis = level % 2;
+    size_t mid = l + (r - l) / 2;
 
+    // The split is the smallest coordinate of the right half. Right after
+    // nth_element that is pts[mid]; in a stored order the children have
+    // been partitioned since, so it has to be searched for.
     auto comp = [axis](const KDPoint &a, const KDPoint &b){ return axis == 0 ? a.x < b.x : a.y < b.y; };
-    std::nth_element(pts_copy.begin()+l, pts_copy.begin()+mid, pts_copy.begin()+r+1, comp);
+    if (!presorted) std::nth_element(pts.begin()+l, pts.begin()+mid, pts.begin()+r, comp);
+    const KDPoint &lo = presorted ? *std::min_element(pts.begin()+mid, pts.begin()+r, comp) : pts[mid];
+    splits[node] = axis == 0 ? lo.x : lo.y;
 
-    KDNode *node = new KDNode(pts_copy[mid]);
-    node->left = buildRec(l, mid-1, depth+1);
-    node->right = buildRec(mid+1, r, depth+1);
-    return node;
+    buildRec(pts, 2*node + 1, l, mid, level + 1, presorted);
+    buildRec(pts, 2*node + 2, mid, r, level + 1, presorted);
 }
 
-void KDTree::deleteAll(KDNode *n) {
-    if (!n) return;
-    deleteAll(n->left);
-    deleteAll(n->right);
-    delete n;
+size_t KDTree::memoryBytes() const {
+    return xs.capacity() * sizeof(double) + ys.capacity() * sizeof(double)
+         + ids.capacity() * sizeof(long long) + flags.capacity() + splits.capacity() * sizeof(double);
 }
 
 void KDTree::projectLatLonToMeters(double lat_deg, double lon_deg, double ref_lat_deg,
@@ -52,24 +81,8 @@ void KDTree::projectLatLonToMeters(double lat_deg, double lon_deg, double ref_la
     out_y = EARTH_RADIUS_M * lat;
 }
 
-double KDTree::sqDist(double x1, double y1, double x2, double y2) {
-    double dx = x1-x2, dy = y1-y2;
-    return dx*dx + dy*dy;
-}
-
 long long KDTree::nearest(double lat, double lon) const {
-    return nearest(lat, lon, [](long long){ return true; });
-}
-
-long long KDTree::nearest(double lat, double lon, const std::function<bool(long long)> &valid) const {
-    if (!root) return -1;
-    double qx, qy;
-    projectLatLonToMeters(lat, lon, ref_lat_deg, qx, qy);
-
-    long long bestId = -1;
-    double bestDist = std::numeric_limits<double>::infinity();
-    nearestRec(root, qx, qy, 0, bestId, bestDist, valid);
-    return bestId;
+    return nearestAt(lat, lon, [](size_t){ return true; });
 }
 
 long long KDTree::secondNearest(double lat, double lon) const {
@@ -78,63 +91,18 @@ long long KDTree::secondNearest(double lat, double lon) const {
     return nearest(lat, lon, [first](long long id){ return id != first; });
 }
 
-void KDTree::nearestRec(KDNode *node, double qx, double qy, int depth,
-                        long long &bestId, double &bestDist,
-                        const std::function<bool(long long)> &valid) const
-{
-    if (!node) return;
-    double d2 = sqDist(node->pt.x, node->pt.y, qx, qy);
-    if (valid(node->pt.id) && d2 < bestDist) { bestDist = d2; bestId = node->pt.id; }
-    int axis = depth%2;
-    double diff = (axis==0 ? qx-node->pt.x : qy-node->pt.y);
-    KDNode *first = diff<0 ? node->left : node->right;
-    KDNode *second = diff<0 ? node->right : node->left;
-    nearestRec(first, qx, qy, depth+1, bestId, bestDist, valid);
-    if (second && diff*diff < bestDist)
-        nearestRec(second, qx, qy, depth+1, bestId, bestDist, valid);
-}
-
 std::vector<long long> KDTree::kNearest(double lat, double lon, int k) const {
-    return kNearest(lat, lon, k, [](long long){ return true; });
+    return kNearestAt(lat, lon, k, [](size_t){ return true; });
 }
 
-std::vector<long long> KDTree::kNearest(double lat, double lon, int k,
-                                        const std::function<bool(long long)> &valid) const
-{
-    std::vector<long long> out;
-    if (!root || k<=0) return out;
-    double qx, qy;
-    projectLatLonToMeters(lat, lon, ref_lat_deg, qx, qy);
-
-    using Pair = std::pair<double,long long>;
-    auto cmp = [](const Pair &a, const Pair &b){ return a.first < b.first; };
-    std::priority_queue<Pair, std::vector<Pair>, decltype(cmp)> heap(cmp);
-
-    kNearestRec(root, qx, qy, 0, k, heap, valid);
-
-    std::vector<Pair> items;
-    while (!heap.empty()){ items.push_back(heap.top()); heap.pop(); }
-    std::sort(items.begin(), items.end(), [](const Pair &a, const Pair &b){ return a.first < b.first; });
-    for (auto &p: items) out.push_back(p.second);
-    return out;
+std::vector<std::vector<long long>> KDTree::kNearestBatch(const std::vector<std::pair<double, double>> &queries, int k,
+                                                          uint8_t required, int threads) const {
+    return batchQuery(queries, threads, [&](double lat, double lon) {
+        return required == 0 ? kNearest(lat, lon, k) : kNearestFlagged(lat, lon, k, required);
+    });
 }
 
-// Template version fixes the priority_queue type issue
-template<typename HeapType>
-void KDTree::kNearestRec(KDNode *node, double qx, double qy, int depth, int k,
-                         HeapType &heap, const std::function<bool(long long)> &valid) const
-{
-    if (!node) return;
-    double d2 = sqDist(node->pt.x, node->pt.y, qx, qy);
-    if (valid(node->pt.id)) {
-        if ((int)heap.size()<k) heap.emplace(d2, node->pt.id);
-        else if (d2<heap.top().first){ heap.pop(); heap.emplace(d2,node->pt.id); }
-    }
-    int axis = depth%2;
-    double diff = axis==0 ? qx-node->pt.x : qy-node->pt.y;
-    KDNode *first = diff<0 ? node->left : node->right;
-    KDNode *second = diff<0 ? node->right : node->left;
-    kNearestRec(first,qx,qy,depth+1,k,heap,valid);
-    double worstDist = heap.empty() ? std::numeric_limits<double>::infinity() : heap.top().first;
-    if (second && diff*diff<worstDist) kNearestRec(second,qx,qy,depth+1,k,heap,valid);
+std::vector<long long> KDTree::nearestBatch(const std::vector<std::pair<double, double>> &queries,
+                                            uint8_t required, int threads) const {
+    return firstOfEach(kNearestBatch(queries, 1, required, threads));
 }
@@ -0,0 +1,276 @@
+// Self-contained checks on a synthetic graph, run by ctest.
+//
+//   routing_test [seed]
+//
+// Builds a jittered grid with random weights plus a detached island and
+// checks every engine against a plain Dijkstra, the contraction hierarchy
+// file round-trip, KD-tree and grid snapping against brute force, and the
+// binary snapshot (including rejection of a mismatched fingerprint). Files
+// are written to the working directory. Exits non-zero on any mismatch.
+#include "CH.h"
+#include "GraphLoader.h"
+#include "Log.h"
+#include "Snapshot.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <random>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string &what)
+{
+    if (ok) return;
+    failures++;
+    std::cerr << "FAIL: " << what << "\n";
+}
+
+bool close(double a, double b)
+{
+    if (std::isinf(a) || std::isinf(b)) return a == b;
+    return std::fabs(a - b) <= 1e-6 * std::max(1.0, std::fabs(b));
+}
+
+// side x side grid with a few edges removed, and a 3-node path far away
+// so some queries have no answer. Weights are at least the straight-line
+// length, which A* and ALT need to stay exact.
+CSRGraph syntheticGraph(unsigned seed, int side)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> jitter(-0.0002, 0.0002), stretch(1.0, 1.6), coin(0.0, 1.0);
+    std::vector<long long> ids;
+    std::vector<double> lats, lons;
+    for (int r = 0; r < side; r++)
+        for (int c = 0; c < side; c++) {
+            ids.push_back(1000 + 7LL * (r * side + c));
+            lats.push_back(24.85 + r * 0.001 + jitter(rng));
+            lons.push_back(67.03 + c * 0.001 + jitter(rng));
+        }
+    for (int i = 0; i < 3; i++) {
+        ids.push_back(5 + i);
+        lats.push_back(25.5 + i * 0.001);
+        lons.push_back(68.0);
+    }
+
+    std::vector<CSREdge> edges;
+    auto link = [&](int a, int b) {
+        double d = CSRGraph::haversine(lats[a], lons[a], lats[b], lons[b]);
+        edges.push_back({a, b, (float)(d * stretch(rng))});
+    };
+    for (int r = 0; r < side; r++)
+        for (int c = 0; c < side; c++) {
+            int u = r * side + c;
+            if (c + 1 < side && coin(rng) > 0.1) link(u, u + 1);
+            if (r + 1 < side && coin(rng) > 0.1) link(u, u + side);
+        }
+    const int island = side * side;
+    link(island, island + 1);
+    link(island + 1, island + 2);
+
+    CSRGraph g;
+    g.build(ids, lats, lons, edges);
+    return g;
+}
+
+// Reference distances from one node to every node
+std::vector<double> dijkstra(const CSRGraph &g, int source)
+{
+    std::vector<double> dist(g.numNodes(), std::numeric_limits<double>::infinity());
+    using Item = std::pair<double, int>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> pq;
+    dist[source] = 0.0;
+    pq.push({0.0, source});
+    while (!pq.empty()) {
+        auto [d, u] = pq.top();
+        pq.pop();
+        if (d > dist[u]) continue;
+        for (uint32_t e = g.edgeBegin(u); e < g.edgeEnd(u); e++) {
+            int v = g.target(e);
+            double nd = d + g.weight(e);
+            if (nd < dist[v]) {
+                dist[v] = nd;
+                pq.push({nd, v});
+            }
+        }
+    }
+    return dist;
+}
+
+void testEngines(const CSRGraph &g, unsigned seed)
+{
+    SearchContext ctx;
+    Landmarks lm;
+    lm.build(g, 4, ctx);
+    ContractionHierarchy ch;
+    ch.build(g);
+
+    // Save and reload before querying, so the round-trip is what gets checked
+    check(ch.save("routing_test.ch"), "CH save");
+    ContractionHierarchy loaded;
+    check(loaded.load("routing_test.ch", g), "CH load");
+    check(loaded.numNodes() == ch.numNodes() && loaded.numUpEdges() == ch.numUpEdges(), "CH round-trip size");
+    CSRGraph other = syntheticGraph(seed + 1, 12);
+    ContractionHierarchy stale;
+    check(!stale.load("routing_test.ch", other), "CH load rejects another graph");
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> pick(0, g.numNodes() - 1);
+    std::uniform_real_distribution<double> offset(0.0, 50.0);
+    const int queries = 200;
+    std::vector<std::vector<SearchEndpoint>> sources, targets;
+    for (int q = 0; q < queries; q++) {
+        // Two seeds per side with offsets, as edge snapping produces
+        std::vector<SearchEndpoint> s, t;
+        for (int i = 0; i < 2; i++) {
+            double so = offset(rng), to = offset(rng);
+            s.push_back({pick(rng), so, so});
+            t.push_back({pick(rng), to, to});
+        }
+        double best = std::numeric_limits<double>::infinity();
+        for (const auto &a : s) {
+            std::vector<double> dist = dijkstra(g, a.node);
+            for (const auto &b : t) best = std::min(best, a.offset + dist[b.node] + b.offset);
+        }
+        std::string tag = "query " + std::to_string(q);
+        auto expect = [&](const PathResult &r, const char *engine) {
+            check(r.found == !std::isinf(best), std::string(engine) + " reachability, " + tag);
+            if (r.found) check(close(r.distance, best), std::string(engine) + " distance, " + tag);
+        };
+        expect(Algorithms::AstarMulti(g, s, t, ctx), "astar");
+        expect(Algorithms::AstarALT(g, lm, s, t, ctx), "alt");
+        expect(Algorithms::BidirectionalDijkstraMulti(g, s, t, ctx), "bidijkstra");
+        expect(Algorithms::BidirectionalAstarMulti(g, s, t, ctx), "biastar");
+        expect(ch.query(g, s, t, ctx), "ch");
+        expect(loaded.query(g, s, t, ctx), "loaded ch");
+
+        if (q < 30) {
+            sources.push_back(s);
+            targets.push_back(t);
+        }
+    }
+
+    // Matrices: entry (i, j) against the per-pair reference
+    std::vector<double> plain = Algorithms::distanceMatrix(g, sources, targets, 2);
+    std::vector<double> bucket = loaded.distanceMatrix(g, sources, targets, 2);
+    for (size_t i = 0; i < sources.size(); i++) {
+        std::vector<std::vector<double>> dist;
+        for (const auto &a : sources[i]) dist.push_back(dijkstra(g, a.node));
+        for (size_t j = 0; j < targets.size(); j++) {
+            double best = std::numeric_limits<double>::infinity();
+            for (size_t a = 0; a < sources[i].size(); a++)
+                for (const auto &b : targets[j])
+                    best = std::min(best, sources[i][a].offset + dist[a][b.node] + b.offset);
+            std::string tag = "cell " + std::to_string(i) + "," + std::to_string(j);
+            check(close(plain[i * targets.size() + j], best), "distanceMatrix " + tag);
+            check(close(bucket[i * targets.size() + j], best), "CH distanceMatrix " + tag);
+        }
+    }
+}
+
+// Both indexes must return a point as close as the brute-force nearest;
+// ties and projection rounding may pick a different node.
+template<typename Index>
+void testIndex(const CSRGraph &g, const Index &index, const char *name, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> lat(24.84, 24.88), lon(67.02, 67.06);
+    const int k = 5;
+    for (int q = 0; q < 300; q++) {
+        double qlat = lat(rng), qlon = lon(rng);
+        std::string tag = std::string(name) + " query " + std::to_string(q);
+        for (uint8_t required : {(uint8_t)0, (uint8_t)SNAP_MAIN_COMPONENT}) {
+            std::vector<double> brute;
+            for (int i = 0; i < g.numNodes(); i++)
+                if (!required || g.component(i) == g.largestComponent())
+                    brute.push_back(CSRGraph::haversine(qlat, qlon, g.lat(i), g.lon(i)));
+            std::sort(brute.begin(), brute.end());
+
+            std::vector<long long> got = index.kNearestFlagged(qlat, qlon, k, required);
+            check((int)got.size() == k, tag + " k results");
+            for (size_t i = 0; i < got.size(); i++) {
+                double d = CSRGraph::haversine(qlat, qlon, g.lat((int)got[i]), g.lon((int)got[i]));
+                check(d <= brute[i] * (1 + 1e-4) + 1e-3, tag + " k-nearest rank " + std::to_string(i));
+                if (required) check(g.component((int)got[i]) == g.largestComponent(), tag + " flag filter");
+            }
+            long long one = index.nearestFlagged(qlat, qlon, required);
+            check(one >= 0 && CSRGraph::haversine(qlat, qlon, g.lat((int)one), g.lon((int)one))
+                                  <= brute[0] * (1 + 1e-4) + 1e-3, tag + " nearest");
+        }
+    }
+}
+
+void testSnapshot(const CSRGraph &g, const KDTree &kdt)
+{
+    std::vector<int32_t> kdOrder;
+    for (long long id : kdt.buildOrder()) kdOrder.push_back((int32_t)id);
+    std::string error;
+    check(snapshot::write("routing_test.bin", g, kdOrder, &error), "snapshot write: " + error);
+
+    CSRGraph loaded;
+    std::vector<int32_t> loadedOrder;
+    check(snapshot::load("routing_test.bin", loaded, loadedOrder, true, &error), "snapshot load: " + error);
+    check(loaded.fingerprint() == g.fingerprint() && loaded.computeFingerprint() == g.fingerprint(),
+          "snapshot fingerprint");
+    check(loaded.numNodes() == g.numNodes() && loaded.numEdges() == g.numEdges(), "snapshot counts");
+    check(loadedOrder == kdOrder, "snapshot KD order");
+    bool same = loaded.largestComponent() == g.largestComponent();
+    for (int u = 0; u < g.numNodes() && same; u++) {
+        same = loaded.id(u) == g.id(u) && loaded.lat(u) == g.lat(u) && loaded.lon(u) == g.lon(u)
+            && loaded.component(u) == g.component(u) && loaded.indexOf(g.id(u)) == u;
+        for (uint32_t e = g.edgeBegin(u); e < g.edgeEnd(u) && same; e++)
+            same = loaded.target(e) == g.target(e) && loaded.weight(e) == g.weight(e);
+    }
+    check(same, "snapshot arrays");
+
+    // The stored fingerprint sits at byte 40 of the header
+    {
+        std::fstream f("routing_test.bin", std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(40);
+        f.put((char)0x5a);
+    }
+    CSRGraph rejected;
+    error.clear();
+    check(!snapshot::load("routing_test.bin", rejected, loadedOrder, false, &error) && rejected.empty(),
+          "snapshot with a wrong fingerprint is rejected");
+    check(error.find("fingerprint") != std::string::npos, "snapshot rejection names the fingerprint: " + error);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const unsigned seed = argc > 1 ? (unsigned)std::atoi(argv[1]) : 7;
+    logging::setOutput(stderr);
+
+    CSRGraph g = syntheticGraph(seed, 20);
+    check(g.numComponents() >= 2, "synthetic graph has an island");
+
+    testEngines(g, seed);
+
+    std::vector<KDPoint> points;
+    for (int i = 0; i < g.numNodes(); i++) points.push_back({i, g.lat(i), g.lon(i)});
+    KDTree kdt;
+    kdt.build(points);
+    setSnapFlags(g, kdt);
+    GridIndex grid;
+    buildGridIndex(g, grid);
+    testIndex(g, kdt, "kdtree", seed);
+    testIndex(g, grid, "grid", seed);
+
+    testSnapshot(g, kdt);
+
+    std::remove("routing_test.ch");
+    std::remove("routing_test.bin");
+    if (failures) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cerr << "All checks passed\n";
+    return 0;
+}
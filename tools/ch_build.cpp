@@ -0,0 +1,61 @@
+// Offline Contraction Hierarchies preprocessing.
+//
+//   ch_build [nodes.csv] [nodes.txt] [graph.ch] [--snapshot graph.bin] [--verify N]
+//
+// Loads the graph exactly like the server does (the snapshot when given,
+// otherwise the text files), contracts it and writes the hierarchy file
+// the server picks up (CH_FILE, default graph.ch).
+// --verify compares N random CH queries against Dijkstra.
+#include "CH.h"
+#include "GraphLoader.h"
+#include <random>
+#include <cstring>
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> files = {"nodes.csv", "nodes.txt", "graph.ch"};
+    std::string snapshotFile;
+    int verify = 0;
+    for (int i = 1, f = 0; i < argc; i++) {
+        if (std::strcmp(argv[i], "--verify") == 0 && i + 1 < argc) verify = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) snapshotFile = argv[++i];
+        else if (f < 3) files[f++] = argv[i];
+    }
+
+    Graph g;
+    KDTree kdt;
+    loadRoutingData(g, kdt, snapshotFile, files[0], files[1]);
+    const CSRGraph &csr = g.get_csr();
+    std::cout << "Graph: " << csr.numNodes() << " nodes, " << csr.numEdges() << " directed edges\n";
+
+    ContractionHierarchy ch;
+    ch.build(csr, true);
+
+    if (!ch.save(files[2])) {
+        std::cerr << "Failed to write " << files[2] << std::endl;
+        return 1;
+    }
+    std::cout << "Hierarchy written to " << files[2] << std::endl;
+
+    if (verify > 0 && csr.numNodes() > 0) {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> pick(0, csr.numNodes() - 1);
+        SearchContext ctx;
+        int mismatches = 0;
+        for (int i = 0; i < verify; i++) {
+            int s = pick(rng), t = pick(rng);
+            PathResult ref = Algorithms::Dijkstra(g, csr.id(s), csr.id(t), ctx);
+            PathResult got = ch.query(csr, {{s, 0.0}}, {{t, 0.0}}, ctx);
+            bool same = ref.found == got.found &&
+                        (!ref.found || std::fabs(ref.distance - got.distance) <= 1e-3 * std::max(1.0, ref.distance));
+            if (!same) {
+                mismatches++;
+                std::cerr << "Mismatch " << csr.id(s) << " -> " << csr.id(t) << ": dijkstra "
+                          << ref.distance << ", ch " << got.distance << std::endl;
+            }
+        }
+        std::cout << "Verified " << verify << " queries, " << mismatches << " mismatches\n";
+        if (mismatches) return 1;
+    }
+    return 0;
+}
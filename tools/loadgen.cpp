@@ -0,0 +1,346 @@
+// HTTP load generator for minimap_server.
+//
+//   loadgen <requests.jsonl> [--host 127.0.0.1] [--port 5000] [--path /shortest-path]
+//           [--concurrency C] [--requests N | --duration S] [--rate R] [--warmup N]
+//           [--json out.json|-]
+//
+// Every non-empty line of the input file is one JSON request body, e.g.
+//   {"start":{"lat":24.81,"lng":66.99},"end":{"lat":24.90,"lng":67.08},"mode":"ch"}
+// and lines are replayed in order, wrapping around, over C keep-alive
+// connections.
+//
+// Closed loop (default): each connection sends its next request as soon as
+// the previous answer arrives, measuring the server's capacity.
+// Open loop (--rate R): requests are due at fixed 1/R intervals regardless
+// of how fast the server answers, and latency is measured from the time a
+// request was due, so queueing behind a slow server is counted instead of
+// hidden (no coordinated omission).
+//
+// Latencies go into a log-linear histogram (HDR-style, < 1% relative
+// error) per connection, merged at the end.
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Counts of microsecond values in buckets of 128 sub-buckets per power of
+// two, so every recorded value is within 1/128 of its bucket's bounds.
+class LatencyHistogram
+{
+public:
+    static constexpr int SUB_BITS = 7;
+    static constexpr int SUB = 1 << SUB_BITS;
+
+    LatencyHistogram() : counts((64 - SUB_BITS) * SUB, 0) {}
+
+    void record(uint64_t us)
+    {
+        counts[bucketOf(us)]++;
+        total++;
+        sum += us;
+        maxValue = std::max(maxValue, us);
+        minValue = std::min(minValue, us);
+    }
+
+    void merge(const LatencyHistogram &o)
+    {
+        for (size_t i = 0; i < counts.size(); i++) counts[i] += o.counts[i];
+        total += o.total;
+        sum += o.sum;
+        maxValue = std::max(maxValue, o.maxValue);
+        minValue = std::min(minValue, o.minValue);
+    }
+
+    // Upper bound of the bucket holding the p-th percentile
+    uint64_t percentile(double p) const
+    {
+        if (total == 0) return 0;
+        uint64_t rank = (uint64_t)std::ceil(p / 100.0 * total);
+        rank = std::max<uint64_t>(1, rank);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            seen += counts[i];
+            if (seen >= rank) return std::min(maxValue, upperOf(i));
+        }
+        return maxValue;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return maxValue; }
+    uint64_t min() const { return total ? minValue : 0; }
+    double mean() const { return total ? (double)sum / total : 0.0; }
+
+private:
+    std::vector<uint64_t> counts;
+    uint64_t total = 0, sum = 0, maxValue = 0, minValue = UINT64_MAX;
+
+    // Values below SUB are exact; above, the top SUB_BITS + 1 bits select
+    // the bucket within the value's power of two.
+    static size_t bucketOf(uint64_t v)
+    {
+        if (v < (uint64_t)SUB) return (size_t)v;
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - SUB_BITS;
+        return (size_t)(shift + 1) * SUB + (size_t)((v >> shift) - SUB);
+    }
+
+    static uint64_t upperOf(size_t bucket)
+    {
+        if (bucket < (size_t)SUB) return bucket;
+        int shift = (int)(bucket / SUB) - 1;
+        uint64_t sub = bucket % SUB + SUB;
+        return ((sub + 1) << shift) - 1;
+    }
+};
+
+struct Options
+{
+    std::string host = "127.0.0.1";
+    std::string port = "5000";
+    std::string path = "/shortest-path";
+    int concurrency = 8;
+    long long requests = 0;  // 0 = bounded by duration
+    double duration = 10.0;  // seconds, when requests == 0
+    double rate = 0.0;       // requests/s, 0 = closed loop
+    int warmup = 0;          // requests per connection left out of the stats
+    std::string jsonFile;
+};
+
+// One keep-alive HTTP/1.1 connection
+class Connection
+{
+public:
+    explicit Connection(const Options &opt) : opt(opt) {}
+    ~Connection() { close(); }
+
+    // Sends body and waits for the whole response; returns the status code
+    // or 0 on a transport error (the connection is dropped and reopened on
+    // the next call).
+    int post(const std::string &body)
+    {
+        if (fd < 0 && !open()) return 0;
+        std::string req = "POST " + opt.path + " HTTP/1.1\r\nHost: " + opt.host +
+                          "\r\nContent-Type: application/json\r\nContent-Length: " +
+                          std::to_string(body.size()) + "\r\nConnection: keep-alive\r\n\r\n" + body;
+        if (!sendAll(req)) { close(); return 0; }
+
+        size_t headerEnd;
+        while ((headerEnd = buf.find("\r\n\r\n")) == std::string::npos)
+            if (!fill()) { close(); return 0; }
+
+        int status = 0;
+        if (buf.compare(0, 9, "HTTP/1.1 ") == 0 || buf.compare(0, 9, "HTTP/1.0 ") == 0)
+            status = std::atoi(buf.c_str() + 9);
+        std::string headers = buf.substr(0, headerEnd);
+        std::transform(headers.begin(), headers.end(), headers.begin(), ::tolower);
+        size_t length = 0;
+        size_t at = headers.find("content-length:");
+        if (at != std::string::npos) length = std::strtoull(headers.c_str() + at + 15, nullptr, 10);
+        bool closeAfter = headers.find("connection: close") != std::string::npos;
+
+        size_t need = headerEnd + 4 + length;
+        while (buf.size() < need)
+            if (!fill()) { close(); return 0; }
+        buf.erase(0, need);
+        if (closeAfter) close();
+        return status;
+    }
+
+private:
+    const Options &opt;
+    int fd = -1;
+    std::string buf;
+
+    bool open()
+    {
+        addrinfo hints{}, *res = nullptr;
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(opt.host.c_str(), opt.port.c_str(), &hints, &res) != 0) return false;
+        for (addrinfo *a = res; a; a = a->ai_next) {
+            fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (fd < 0) continue;
+            if (::connect(fd, a->ai_addr, a->ai_addrlen) == 0) break;
+            ::close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(res);
+        if (fd < 0) return false;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        buf.clear();
+        return true;
+    }
+
+    void close()
+    {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        buf.clear();
+    }
+
+    bool sendAll(const std::string &data)
+    {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) return false;
+            sent += (size_t)n;
+        }
+        return true;
+    }
+
+    bool fill()
+    {
+        char chunk[16384];
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) return false;
+        buf.append(chunk, (size_t)n);
+        return true;
+    }
+};
+
+struct WorkerStats
+{
+    LatencyHistogram latency;
+    uint64_t ok = 0;          // 2xx
+    uint64_t httpErrors = 0;  // any other status
+    uint64_t transportErrors = 0;
+};
+
+std::vector<std::string> loadBodies(const std::string &filename)
+{
+    std::vector<std::string> bodies;
+    std::ifstream in(filename);
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t b = line.find_first_not_of(" \t\r");
+        if (b == std::string::npos) continue;
+        size_t e = line.find_last_not_of(" \t\r");
+        bodies.push_back(line.substr(b, e - b + 1));
+    }
+    return bodies;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    std::string input;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--host") == 0 && i + 1 < argc) opt.host = argv[++i];
+        else if (std::strcmp(argv[i], "--port") == 0 && i + 1 < argc) opt.port = argv[++i];
+        else if (std::strcmp(argv[i], "--path") == 0 && i + 1 < argc) opt.path = argv[++i];
+        else if (std::strcmp(argv[i], "--concurrency") == 0 && i + 1 < argc) opt.concurrency = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--requests") == 0 && i + 1 < argc) opt.requests = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--duration") == 0 && i + 1 < argc) opt.duration = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc) opt.rate = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) opt.warmup = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) opt.jsonFile = argv[++i];
+        else input = argv[i];
+    }
+    std::ostream &out = opt.jsonFile == "-" ? std::cerr : std::cout;
+
+    std::vector<std::string> bodies = loadBodies(input);
+    if (bodies.empty()) {
+        std::cerr << "usage: loadgen <requests.jsonl> [options] (no request bodies in '" << input << "')" << std::endl;
+        return 1;
+    }
+    out << "Replaying " << bodies.size() << " request bodies against http://" << opt.host << ":" << opt.port
+        << opt.path << " on " << opt.concurrency << " connections, "
+        << (opt.rate > 0 ? "open loop at " + std::to_string((long long)opt.rate) + " req/s" : std::string("closed loop"))
+        << std::endl;
+
+    // Requests are numbered globally; in open loop request i is due at
+    // start + i / rate whichever connection ends up sending it.
+    std::atomic<long long> next{0};
+    std::vector<WorkerStats> stats(opt.concurrency);
+    std::vector<std::thread> workers;
+    const Clock::time_point start = Clock::now() + std::chrono::milliseconds(10);
+    const Clock::time_point deadline = start + std::chrono::microseconds((long long)(opt.duration * 1e6));
+
+    for (int w = 0; w < opt.concurrency; w++) {
+        workers.emplace_back([&, w]() {
+            Connection conn(opt);
+            WorkerStats &st = stats[w];
+            int warm = opt.warmup;
+            std::this_thread::sleep_until(start);
+            for (;;) {
+                long long i = next.fetch_add(1);
+                if (opt.requests > 0 && i >= opt.requests) break;
+
+                Clock::time_point due = Clock::now();
+                if (opt.rate > 0) {
+                    due = start + std::chrono::nanoseconds((long long)(i * 1e9 / opt.rate));
+                    if (opt.requests == 0 && due >= deadline) break;
+                    std::this_thread::sleep_until(due);
+                } else if (opt.requests == 0 && due >= deadline) {
+                    break;
+                }
+
+                int status = conn.post(bodies[i % bodies.size()]);
+                uint64_t us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - due).count();
+                if (warm > 0) { warm--; continue; }
+                if (status == 0) st.transportErrors++;
+                else if (status >= 200 && status < 300) st.ok++;
+                else st.httpErrors++;
+                if (status != 0) st.latency.record(us);
+            }
+        });
+    }
+    for (auto &t : workers) t.join();
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    WorkerStats total;
+    for (const WorkerStats &st : stats) {
+        total.latency.merge(st.latency);
+        total.ok += st.ok;
+        total.httpErrors += st.httpErrors;
+        total.transportErrors += st.transportErrors;
+    }
+    const uint64_t answered = total.ok + total.httpErrors;
+    const double throughput = elapsed > 0 ? answered / elapsed : 0.0;
+    const char *pcts[] = {"50", "90", "95", "99", "99.9"};
+    auto ms = [](uint64_t us) { return us / 1000.0; };
+
+    out << std::fixed << std::setprecision(3);
+    out << "Requests: " << answered << " answered (" << total.ok << " 2xx, " << total.httpErrors
+        << " other), " << total.transportErrors << " transport errors in " << elapsed << " s\n";
+    out << "Throughput: " << std::setprecision(1) << throughput << " req/s\n" << std::setprecision(3);
+    out << "Latency ms: min " << ms(total.latency.min()) << ", mean " << total.latency.mean() / 1000.0;
+    for (const char *p : pcts) out << ", p" << p << " " << ms(total.latency.percentile(std::atof(p)));
+    out << ", max " << ms(total.latency.max()) << "\n";
+
+    if (!opt.jsonFile.empty()) {
+        std::ofstream file;
+        if (opt.jsonFile != "-") file.open(opt.jsonFile);
+        std::ostream &js = opt.jsonFile == "-" ? std::cout : file;
+        js << std::fixed << std::setprecision(3);
+        js << "{\"path\": \"" << opt.path << "\", \"concurrency\": " << opt.concurrency
+           << ", \"rate\": " << opt.rate << ", \"elapsed_s\": " << elapsed
+           << ", \"ok\": " << total.ok << ", \"http_errors\": " << total.httpErrors
+           << ", \"transport_errors\": " << total.transportErrors << ", \"throughput\": " << throughput
+           << ", \"latency_ms\": {\"min\": " << ms(total.latency.min()) << ", \"mean\": " << total.latency.mean() / 1000.0;
+        for (const char *p : pcts) js << ", \"p" << p << "\": " << ms(total.latency.percentile(std::atof(p)));
+        js << ", \"max\": " << ms(total.latency.max()) << "}}\n";
+    }
+    return total.transportErrors > 0 && answered == 0 ? 1 : 0;
+}